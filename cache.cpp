@@ -1,24 +1,36 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include "cache.h"
 
-extern uns64 SWP_CORE0_WAYS; // Static Way Partitioning
 extern uns64 cycle; // You can use this as timestamp for LRU
 extern uns64 CACHE_LINESIZE;
-extern uns64 L2CACHE_SIZE;
-extern uns64 L2CACHE_ASSOC;
+
+// Dirty victims made up for unsampled sets are written back from a
+// line address region far above data and page-table lines (tlb.cpp),
+// so they never alias a real line. The low bits are the filled line's,
+// which keeps the writeback on the same DRAM channel and bank.
+#define CACHE_SYNTH_VICTIM_BASE  (1ULL<<48)
+
+static void cache_bind_repl(Cache *c, uns64 repl_policy);
+static void cache_bind_index(Cache *c);
+static uns64 *cache_meta_alloc(Cache *c, uns64 num_sets);
+static Flag cache_access_packed(Cache *c, uns set_index, Addr lineaddr, uns is_write, uns core_id);
+static Flag cache_invalidate_packed(Cache *c, uns set_index, Addr lineaddr, uns core_id, Flag *was_dirty);
+static Flag cache_probe_packed(Cache *c, uns set_index, Addr lineaddr, uns core_id);
 
 ////////////////////////////////////////////////////////////////////
 // ------------- DO NOT MODIFY THE INIT FUNCTION -----------
 ////////////////////////////////////////////////////////////////////
 
-Cache  *cache_new(uns64 size, uns64 assoc, uns64 linesize, uns64 repl_policy){
+Cache  *cache_new(uns64 size, uns64 assoc, uns64 linesize, uns64 repl_policy, Cache_Level level){
 
    Cache *c = (Cache *) calloc (1, sizeof (Cache));
    c->num_ways = assoc;
-   c->repl_policy = repl_policy;
+   c->level = level;
+   cache_bind_repl(c, repl_policy);
 
    if(c->num_ways > MAX_WAYS){
      printf("Change MAX_WAYS in cache.h to support %llu ways\n", c->num_ways);
@@ -28,10 +40,92 @@ Cache  *cache_new(uns64 size, uns64 assoc, uns64 linesize, uns64 repl_policy){
    // determine num sets, and init the cache
    c->num_sets = size/(linesize*assoc);
    c->sets  = (Cache_Set *) calloc (c->num_sets, sizeof(Cache_Set));
+   c->sample_ratio = 1;
+
+   // power-of-two caches index with a mask, the rest fall back to modulo
+   if(c->num_sets & (c->num_sets - 1)){
+     cache_set_index_fn(c, CACHE_INDEX_MOD);
+   } else {
+     cache_set_index_fn(c, CACHE_INDEX_MASK);
+   }
+
+   // every core starts in class 0, which owns all the ways
+   for(uns ii=0; ii<MAX_CLOS; ii++){
+     c->clos_mask[ii] = (1ULL << c->num_ways) - 1;
+   }
+   for(uns ii=0; ii<MAX_CORES; ii++){
+     c->way_mask[ii] = (1ULL << c->num_ways) - 1;
+   }
 
    return c;
 }
 
+////////////////////////////////////////////////////////////////////
+// Set index functions. Access, install and invalidate are compiled
+// once per index function and bound through c->index, and only the
+// skewed ones apply a per-way skew (cache_way_line<TRUE>), so an
+// unskewed cache keeps a single set per access with no test per way.
+////////////////////////////////////////////////////////////////////
+
+// XOR folds the next three index-sized chunks of the tag onto the
+// index, which breaks up power-of-two strides. SKEW indexes way 0
+// with the plain mask.
+template <Cache_Index_Fn INDEX>
+static inline uns64 cache_index_tmpl(Cache *c, Addr lineaddr){
+  if(INDEX == CACHE_INDEX_MOD){
+    return lineaddr % c->num_sets;
+  }
+  if(INDEX == CACHE_INDEX_XOR){
+    uns b = c->index_bits;
+    return (lineaddr ^ (lineaddr >> b) ^ (lineaddr >> 2*b) ^ (lineaddr >> 3*b)) & c->set_mask;
+  }
+  return lineaddr & c->set_mask;
+}
+
+void cache_set_index_fn(Cache *c, Cache_Index_Fn index_fn){
+  uns pow2 = !(c->num_sets & (c->num_sets - 1));
+
+  if((index_fn != CACHE_INDEX_MOD) && !pow2){
+    printf("Hashed/skewed cache indexing needs a power-of-two number of sets (%llu)\n", c->num_sets);
+    exit(-1);
+  }
+  if((index_fn == CACHE_INDEX_SKEW) && (c->sample_ratio > 1)){
+    printf("Skewed caches cannot be set sampled\n");
+    exit(-1);
+  }
+  if((index_fn == CACHE_INDEX_SKEW) && c->packed){
+    printf("Skewed caches cannot use packed metadata\n");
+    exit(-1);
+  }
+
+  c->index_type = index_fn;
+  c->index_bits = pow2 ? __builtin_ctzll(c->num_sets) : 0;
+  c->set_mask   = c->num_sets - 1;
+  c->skew_mask  = pow2 ? c->set_mask : ~0ULL;
+  c->skew_shift = 63;
+  c->skewed     = FALSE;
+  for(uns k=0; k<MAX_WAYS; k++){
+    c->way_skew[k] = 0;
+  }
+
+  if((index_fn == CACHE_INDEX_SKEW) && c->index_bits){
+    // way 0 keeps the plain index, every other way XORs in a different
+    // multiplicative hash of the tag (top index_bits of tag*odd const)
+    c->skewed     = TRUE;
+    c->skew_shift = 64 - c->index_bits;
+    for(uns k=1; k<MAX_WAYS; k++){
+      c->way_skew[k] = (0x9E3779B97F4A7C15ULL * (2*k+1)) | 1;
+    }
+  }
+
+  cache_bind_index(c);
+  cache_bind_repl(c, c->repl.policy);
+}
+
+uns64 cache_set_index(Cache *c, Addr lineaddr){
+  return c->index.set(c, lineaddr);
+}
+
 ////////////////////////////////////////////////////////////////////
 // ------------- DO NOT MODIFY THE PRINT STATS FUNCTION -----------
 ////////////////////////////////////////////////////////////////////
@@ -56,10 +150,108 @@ void    cache_print_stats    (Cache *c, char *header){
   printf("\n%s_WRITE_MISS_PERC \t\t : %10.3f", header, 100*write_mr);
   printf("\n%s_DIRTY_EVICTS   \t\t : %10llu", header, c->stat_dirty_evicts);
 
+  if(c->sample_ratio > 1){
+    cache_print_sampling_stats(c, header);
+  }
+
+  if(c->mclass){
+    missclass_print_stats(c->mclass, header);
+  }
+
+  if(c->dbp){
+    dbp_print_stats(c->dbp, header);
+  }
+
   printf("\n");
 }
 
+////////////////////////////////////////////////////////////////////
+// With set sampling the stats above include extrapolated outcomes for
+// unsampled sets. Here we report the estimate from the sampled sets
+// alone, with a 95% confidence interval. Sets are the sampling units
+// (cluster sampling), so the ratio-estimator variance is used rather
+// than the binomial one, which is far too optimistic when misses
+// concentrate in a few hot sets.
+////////////////////////////////////////////////////////////////////
+
+void    cache_print_sampling_stats(Cache *c, char *header){
+  uns64  num_sampled = c->num_sets/c->sample_ratio;
+  uns64  sampled_access = c->stat_sampled_read_access + c->stat_sampled_write_access;
+  uns64  sampled_miss = c->stat_sampled_read_miss + c->stat_sampled_write_miss;
+  double mr = 0;
+  double ci = 0;
+
+  if(sampled_access){
+    mr = (double)(sampled_miss)/(double)(sampled_access);
+  }
+
+  if(sampled_access && (num_sampled > 1)){
+    double mean_access = (double)(sampled_access)/(double)(num_sampled);
+    double sum_sq = 0;
+    for(uns64 ii=0; ii<num_sampled; ii++){
+      double resid = (double)(c->sample_set_miss[ii]) - mr*(double)(c->sample_set_access[ii]);
+      sum_sq += resid*resid;
+    }
+    double fpc = 1.0 - 1.0/(double)(c->sample_ratio);
+    double var = fpc * sum_sq / ((double)(num_sampled-1) * (double)(num_sampled) * mean_access * mean_access);
+    ci = 1.96*sqrt(var);
+  }
+
+  uns64 total_access = c->stat_read_access + c->stat_write_access;
+
+  printf("\n%s_SAMPLE_RATIO   \t\t : %10llu", header, c->sample_ratio);
+  printf("\n%s_SAMPLED_SETS   \t\t : %10llu", header, num_sampled);
+  printf("\n%s_SAMPLED_ACCESS \t\t : %10llu", header, sampled_access);
+  printf("\n%s_EST_MISS_PERC  \t\t : %10.3f", header, 100*mr);
+  printf("\n%s_EST_MISS_CI95  \t\t : %10.3f", header, 100*ci);
+  printf("\n%s_EST_MISS       \t\t : %10.0f", header, mr*(double)(total_access));
+  printf("\n%s_EST_MISS_CI95N \t\t : %10.0f", header, ci*(double)(total_access));
+}
+
+
 
+////////////////////////////////////////////////////////////////////
+// Moving average of a 0/1 event seen on the sampled sets. Each sample
+// stands for sample_ratio accesses, so the window spans about
+// CACHE_SAMPLE_WINDOW accesses whatever the ratio. A short window
+// keeps the cold-start misses from leaking far into the run, and a
+// noisy average costs nothing: every draw is linear in it.
+////////////////////////////////////////////////////////////////////
+
+static inline void cache_sample_average(Cache *c, double *avg, Flag event){
+  if (*avg < 0) {
+    *avg = event;
+  } else {
+    *avg += ((double)(event) - *avg)*c->sample_alpha;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// A read touched the line: the read before it was not its last.
+// Writebacks from the L1 carry no PC and leave the prediction alone.
+////////////////////////////////////////////////////////////////////
+
+static inline void cache_dbp_touch(Cache *c, Cache_Line *line, uns core_id){
+  Dead_Block *dbp = c->dbp;
+
+  if (line->dbp_pred) {
+    dbp_train(dbp, line->dbp_sig, FALSE);
+    dbp->stat_dead_wrong += line->dbp_dead;
+  }
+  line->dbp_pred = TRUE;
+  line->dbp_sig  = dbp_signature(c->access_pc, core_id);
+  line->dbp_dead = dbp_is_dead(dbp, line->dbp_sig);
+}
+
+static inline void cache_dbp_evict(Cache *c, Cache_Line *victim){
+  Dead_Block *dbp = c->dbp;
+
+  if (victim->dbp_pred) {
+    dbp_train(dbp, victim->dbp_sig, TRUE);
+    dbp->stat_dead_correct += victim->dbp_dead;
+    dbp->stat_live_wrong   += !victim->dbp_dead;
+  }
+}
 
 ////////////////////////////////////////////////////////////////////
 // Note: the system provides the cache with the line address
@@ -69,12 +261,17 @@ void    cache_print_stats    (Cache *c, char *header){
 ////////////////////////////////////////////////////////////////////
 
 Flag cache_access(Cache *c, Addr lineaddr, uns is_write, uns core_id){
+  return c->index.access(c, lineaddr, is_write, core_id);
+}
+
+template <Cache_Index_Fn INDEX>
+static Flag cache_access_idx(Cache *c, Addr lineaddr, uns is_write, uns core_id){
   // Check: Tushar:'core_id' will be used in both cache_access and cache_install..
   // Your Code Goes Here
   // printf("c->num_sets: %d \t c->num_ways: %d \t SWP_CORE0_WAYS: %d \n", )
   Flag outcome=MISS; // Default value is MISS
   // First calculate the set_index
-  unsigned set_index = lineaddr % c->num_sets;
+  unsigned set_index = cache_index_tmpl<INDEX>(c, lineaddr);
   // update the stats, based on if it's a read_access or write_access
   if (is_write) {
     c->stat_write_access++;
@@ -84,23 +281,43 @@ Flag cache_access(Cache *c, Addr lineaddr, uns is_write, uns core_id){
     // printf("Cycle: %lu \t In: %s \t c->stat_read_access: %lu \n", cycle, __func__, c->stat_read_access);
   }
 
-  // Loop-over all the Cache-lines/ways in a given 'set_index'
-  for (uns k=0; k<c->num_ways; k++) { // complete this for-loop
-  // If cache_line is valid and core_id is same as the one mentioned in the parameter
-    if ((c->sets[set_index].line[k].valid == true) && 
-        (c->sets[set_index].line[k].core_id == core_id)) {
-      // update the counters..
-      if (c->sets[set_index].line[k].tag == lineaddr) {
-        outcome = HIT;
-        // Tushar: Only update the 'last_access_time' of a Cache-line if there's a hit
-        c->sets[set_index].line[k].last_access_time = cycle;
-        if (is_write) {
-          c->sets[set_index].line[k].dirty = true;
-        }
-      } 
+  // With set sampling, unsampled sets have no tags: draw the outcome
+  if (set_index & (c->sample_ratio - 1)) {
+    outcome = cache_sampled_outcome(c, is_write, core_id);
+    if (outcome == MISS) {
+      if (is_write) {
+        c->stat_write_miss++;
+      } else {
+        c->stat_read_miss++;
+      }
+    }
+    return outcome;
+  }
+  set_index >>= c->sample_shift; // sampled sets are stored densely
+
+  if (c->packed) {
+    outcome = cache_access_packed(c, set_index, lineaddr, is_write, core_id);
+  } else {
+    // Loop-over all the Cache-lines/ways in a given 'set_index'
+    for (uns k=0; k<c->num_ways; k++) { // complete this for-loop
+      Cache_Line *line = cache_way_line<INDEX == CACHE_INDEX_SKEW>(c, set_index, lineaddr, k);
+    // If cache_line is valid and core_id is same as the one mentioned in the parameter
+      if ((line->valid == true) && (line->core_id == core_id)) {
+        // update the counters..
+        if (line->tag == lineaddr) {
+          outcome = HIT;
+          // Tushar: Only update the 'last_access_time' of a Cache-line if there's a hit
+          line->last_access_time = cycle;
+          if (is_write) {
+            line->dirty = true;
+          } else if (c->dbp) {
+            cache_dbp_touch(c, line, core_id);
+          }
+        } 
+      }
     }
   }
-  
+
   // Your access to the cache is complete.. update the stats if it's a hit or miss
   if ((outcome == MISS) && is_write) {
     c->stat_write_miss++;
@@ -108,9 +325,187 @@ Flag cache_access(Cache *c, Addr lineaddr, uns is_write, uns core_id){
   if ((outcome == MISS) && !is_write) {
     c->stat_read_miss++;
   }
+
+  if (c->mclass) {
+    missclass_access(c->mclass, lineaddr, core_id, outcome);
+  }
+
+  if (c->sample_ratio > 1) {
+    c->sample_set_access[set_index]++;
+    c->sample_set_miss[set_index] += (outcome == MISS);
+    cache_sample_average(c, &c->sample_miss_rate[core_id][is_write ? 1 : 0], outcome == MISS);
+    if (is_write) {
+      c->stat_sampled_write_access++;
+      c->stat_sampled_write_miss += (outcome == MISS);
+    } else {
+      c->stat_sampled_read_access++;
+      c->stat_sampled_read_miss += (outcome == MISS);
+    }
+  }
   return outcome;
 }
 
+////////////////////////////////////////////////////////////////////
+// Drop a resident line (e.g. when a victim cache hands it back to
+// the L1). Returns HIT if it was present; no stats are touched.
+////////////////////////////////////////////////////////////////////
+
+Flag cache_invalidate(Cache *c, Addr lineaddr, uns core_id, Flag *was_dirty){
+  return c->index.invalidate(c, lineaddr, core_id, was_dirty);
+}
+
+template <Cache_Index_Fn INDEX>
+static Flag cache_invalidate_idx(Cache *c, Addr lineaddr, uns core_id, Flag *was_dirty){
+  uns64 set_index = cache_index_tmpl<INDEX>(c, lineaddr);
+
+  *was_dirty = FALSE;
+  if (set_index & (c->sample_ratio - 1)) {
+    return MISS;
+  }
+  set_index >>= c->sample_shift;
+  if (c->packed) {
+    return cache_invalidate_packed(c, set_index, lineaddr, core_id, was_dirty);
+  }
+
+  for (uns k=0; k<c->num_ways; k++) {
+    Cache_Line *line = cache_way_line<INDEX == CACHE_INDEX_SKEW>(c, set_index, lineaddr, k);
+    if (line->valid && (line->core_id == core_id) && (line->tag == lineaddr)) {
+      *was_dirty = line->dirty;
+      line->valid = FALSE;
+      line->dirty = FALSE;
+      return HIT;
+    }
+  }
+  return MISS;
+}
+
+////////////////////////////////////////////////////////////////////
+// Would an access hit? Nothing is updated, not even recency or stats.
+// An unsampled set has no tags to look at and answers MISS.
+////////////////////////////////////////////////////////////////////
+
+Flag cache_probe(Cache *c, Addr lineaddr, uns core_id){
+  return c->index.probe(c, lineaddr, core_id);
+}
+
+template <Cache_Index_Fn INDEX>
+static Flag cache_probe_idx(Cache *c, Addr lineaddr, uns core_id){
+  uns64 set_index = cache_index_tmpl<INDEX>(c, lineaddr);
+
+  if (set_index & (c->sample_ratio - 1)) {
+    return MISS;
+  }
+  set_index >>= c->sample_shift;
+  if (c->packed) {
+    return cache_probe_packed(c, set_index, lineaddr, core_id);
+  }
+
+  for (uns k=0; k<c->num_ways; k++) {
+    Cache_Line *line = cache_way_line<INDEX == CACHE_INDEX_SKEW>(c, set_index, lineaddr, k);
+    if (line->valid && (line->core_id == core_id) && (line->tag == lineaddr)) {
+      return HIT;
+    }
+  }
+  return MISS;
+}
+
+////////////////////////////////////////////////////////////////////
+// Keep tag state for only 1 in sample_ratio sets (a power of two).
+// Accesses to the other sets get HIT/MISS drawn from the recent miss
+// ratio of the same core on the sampled sets, so cores with small
+// footprints keep their own hit rate and the cold start washes out.
+// Call right after cache_new.
+////////////////////////////////////////////////////////////////////
+
+void cache_enable_sampling(Cache *c, uns64 sample_ratio){
+  if(c->index_type == CACHE_INDEX_SKEW){
+    printf("Skewed caches cannot be set sampled\n");
+    exit(-1);
+  }
+  if((sample_ratio & (sample_ratio - 1)) || (sample_ratio > c->num_sets) ||
+     (c->num_sets % sample_ratio)){
+    printf("Set sampling ratio %llu must be a power of two dividing %llu sets\n", sample_ratio, c->num_sets);
+    exit(-1);
+  }
+
+  c->sample_ratio = sample_ratio;
+  c->sample_shift = __builtin_ctzll(sample_ratio);
+  c->sample_rng   = 0x9E3779B97F4A7C15ULL;
+  c->sample_alpha = (2*sample_ratio < CACHE_SAMPLE_WINDOW) ? (double)(sample_ratio)/CACHE_SAMPLE_WINDOW : 0.5;
+  for (uns ii=0; ii<MAX_CORES; ii++) {
+    c->sample_miss_rate[ii][0] = c->sample_miss_rate[ii][1] = -1;
+    c->sample_dirty_rate[ii]   = -1;
+  }
+
+  uns64 num_sampled = c->num_sets/sample_ratio;
+  if (c->packed) {
+    free(c->meta);
+    c->meta = cache_meta_alloc(c, num_sampled);
+  } else {
+    free(c->sets);
+    c->sets  = (Cache_Set *) calloc (num_sampled, sizeof(Cache_Set));
+  }
+  c->sample_set_access = (uns64 *) calloc (num_sampled, sizeof(uns64));
+  c->sample_set_miss   = (uns64 *) calloc (num_sampled, sizeof(uns64));
+}
+
+////////////////////////////////////////////////////////////////////
+// Classify misses with a shadow of the same capacity. With set
+// sampling only the sampled sets are seen, so the shadow is sized
+// for them (they are an unbiased slice of the address space). Call
+// after cache_enable_sampling.
+////////////////////////////////////////////////////////////////////
+
+void cache_enable_miss_class(Cache *c){
+  c->mclass = missclass_new((c->num_sets/c->sample_ratio)*c->num_ways);
+}
+
+////////////////////////////////////////////////////////////////////
+// Dead block prediction (deadblock.h) for a cache that is told the
+// PC of each access through access_pc. Predicted-dead lines are
+// evicted first; with DBP_BYPASS read misses predicted dead are not
+// filled at all. Trains on the sampled sets only.
+////////////////////////////////////////////////////////////////////
+
+void cache_enable_dbp(Cache *c, uns mode){
+  if (c->packed) {
+    printf("Packed caches keep no room for dead block prediction\n");
+    exit(-1);
+  }
+  c->dbp = dbp_new(mode);
+}
+
+////////////////////////////////////////////////////////////////////
+// Draws for the unsampled sets, from a private xorshift64* stream
+////////////////////////////////////////////////////////////////////
+
+static Flag cache_sample_draw(Cache *c, double p){
+  c->sample_rng ^= c->sample_rng >> 12;
+  c->sample_rng ^= c->sample_rng << 25;
+  c->sample_rng ^= c->sample_rng >> 27;
+  uns64 r = (c->sample_rng * 0x2545F4914F6CDD1DULL) >> 11;  // 53 bits
+  return (double)(r) < p * 9007199254740992.0;
+}
+
+////////////////////////////////////////////////////////////////////
+// Outcome for an access to an unsampled set. A core that has not yet
+// touched a sampled set borrows the other cores' recent ratio; with
+// no traffic at all the cache is cold and misses.
+////////////////////////////////////////////////////////////////////
+
+Flag cache_sampled_outcome(Cache *c, uns is_write, uns core_id){
+  uns    type = is_write ? 1 : 0;
+  double mr   = c->sample_miss_rate[core_id][type];
+
+  for (uns ii=0; (mr < 0) && (ii<MAX_CORES); ii++) {
+    mr = c->sample_miss_rate[ii][type];
+  }
+  if (mr < 0) {
+    return MISS;
+  }
+  return cache_sample_draw(c, mr) ? MISS : HIT;
+}
+
 ////////////////////////////////////////////////////////////////////
 // Note: the system provides the cache with the line address
 // Install the line: determine victim using repl policy (LRU/RAND)
@@ -118,6 +513,11 @@ Flag cache_access(Cache *c, Addr lineaddr, uns is_write, uns core_id){
 ////////////////////////////////////////////////////////////////////
 
 void cache_install(Cache *c, Addr lineaddr, uns is_write, uns core_id){
+  c->index.install(c, lineaddr, is_write, core_id);
+}
+
+template <Cache_Index_Fn INDEX>
+static void cache_install_idx(Cache *c, Addr lineaddr, uns is_write, uns core_id){
 
   // Find victim using cache_find_victim
   // Initialize the evicted entry (c->last_evicted_line)
@@ -127,72 +527,142 @@ void cache_install(Cache *c, Addr lineaddr, uns is_write, uns core_id){
   // lineaddr doesnot have your byte-offset.. basically lineaddr = (tag + index)
   // just to make things easy you can put your entire 'lineaddr' in tag
 
-  unsigned set_index = lineaddr % c->num_sets;
-  unsigned victim_index = c->num_ways;
-  Flag L2_access = false;
+  unsigned set_index = cache_index_tmpl<INDEX>(c, lineaddr);
 
-  if((c->num_ways == L2CACHE_ASSOC) && ((c->num_ways*c->num_sets*CACHE_LINESIZE) == L2CACHE_SIZE)) {
-    // printf("@Cycle: %d \t L2 Cache access\n", cycle);
-    L2_access = true;
-    // assert(0);
+  // Unsampled set: evict a dirty line as often as this core's fills
+  // recently did in the sampled sets, so the writeback traffic below
+  // this cache is preserved
+  if (set_index & (c->sample_ratio - 1)) {
+    c->last_evicted_line.valid = false;
+    if ((c->sample_dirty_rate[core_id] > 0) &&
+        cache_sample_draw(c, c->sample_dirty_rate[core_id])) {
+      c->last_evicted_line.valid = TRUE;
+      c->last_evicted_line.dirty = TRUE;
+      c->last_evicted_line.tag = CACHE_SYNTH_VICTIM_BASE | lineaddr;
+      c->last_evicted_line.core_id = core_id;
+      c->stat_dirty_evicts++;
+    }
+    return;
+  }
+  set_index >>= c->sample_shift;
+
+  // A fill predicted dead goes straight to the level above. Dirty
+  // data from the L1 is always kept.
+  if (c->dbp && !is_write) {
+    uns16 sig = dbp_signature(c->access_pc, core_id);
+    dbp_check_bypass(c->dbp, lineaddr);
+    if ((c->dbp->mode == DBP_BYPASS) && dbp_is_dead(c->dbp, sig)) {
+      c->last_evicted_line.valid = false;
+      dbp_bypassed(c->dbp, lineaddr, sig);
+      return;
+    }
+    c->dbp->stat_fills++;
   }
 
-  // check if space is avaliable in a given set_index
+  c->repl.install(c, set_index, lineaddr, is_write, core_id);
 
-  if (L2_access) { // On L2 access
-    if(SWP_CORE0_WAYS == 0) { // If there is no Static Way Partition
-      for (uns i=0; i<c->num_ways; i++) { // Scan through the whole cache
-        if (c->sets[set_index].line[i].valid == false) {
-          victim_index = i;
-          break;
-        }
-      }      
-    } else if (SWP_CORE0_WAYS) { // Scan through cache per core basis
-      if(core_id == 0) { // Core0
-        for(uns i=0; i<SWP_CORE0_WAYS; i++) { // core0 will scan till SWP_CORE0_WAYS
-          if (c->sets[set_index].line[i].valid == false) {
-            victim_index = i;
-            break;
-          }
-        }
-      } else if (core_id == 1) { // Core1
-        for(uns i=SWP_CORE0_WAYS; i<c->num_ways; i++) { // core1 will scan from SWP_CORE0_WAYS onwards..
-          if (c->sets[set_index].line[i].valid == false) {
-            victim_index = i;
-            break;
-          }        
-        }
-      }
+  if (c->sample_ratio > 1) {
+    cache_sample_average(c, &c->sample_dirty_rate[core_id],
+                         c->last_evicted_line.valid && c->last_evicted_line.dirty);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// You may find it useful to split victim selection from install
+////////////////////////////////////////////////////////////////////
+
+// Check: Return the address of the victim to be evicted
+// I think if should be the 'way' of the victim in the given
+// set to be evicted... i.e the index of the line.
+uns cache_find_victim(Cache *c, uns set_index, Addr lineaddr, uns core_id){
+  return c->repl.find_victim(c, set_index, lineaddr, core_id);
+}
+
+////////////////////////////////////////////////////////////////////
+// Replacement, specialized per (level, policy, skew) at compile time.
+// MASKED (the shared L2) restricts both the free-way scan and the
+// victim to the ways in the core's mask: SWP, UCP and CAT partitions
+// are all way masks. A private L1 considers the whole set.
+////////////////////////////////////////////////////////////////////
+
+// pick the k-th allowed way
+static inline uns cache_random_way(uns64 mask){
+  uns k = rand() % __builtin_popcountll(mask);
+  while (k--) {
+    mask &= mask - 1;
+  }
+  return __builtin_ctzll(mask);
+}
+
+template <Flag MASKED, uns64 POLICY, Flag SKEWED>
+static uns cache_find_victim_tmpl(Cache *c, uns set_index, Addr lineaddr, uns core_id){
+  uns64 mask = MASKED ? c->way_mask[core_id] : (1ULL << c->num_ways) - 1;
+  Flag  dead_only = FALSE;
+
+  // predicted-dead lines go first, in policy order among themselves
+  if (c->dbp) {
+    uns64 dead = 0;
+    for (uns64 m = mask; m; m &= m - 1) {
+      uns i = __builtin_ctzll(m);
+      dead |= (uns64)(cache_way_line<SKEWED>(c, set_index, lineaddr, i)->dbp_dead) << i;
     }
-  } else { // If icache/dcache which are per core.. scan through the entire cache
-           // there's no SWP_CORE0_WAYS restriction 
-      for (uns i=0; i<c->num_ways; i++) { 
-        if (c->sets[set_index].line[i].valid == false) {
-          victim_index = i;
-          break;
-        }
-      }
+    if (dead) {
+      mask = dead;
+      dead_only = TRUE;
+    }
+  }
+
+  if (POLICY == REPL_RAND) { // Random replacement policy
+    if (!MASKED && !dead_only) {
+      return rand() % (c->num_ways);
+    }
+    return cache_random_way(mask);
+  }
+
+  // LRU: looping over the allowed ways to find the minimum time
+  uns smallest_cycle_count = cycle;
+  uns victim = __builtin_ctzll(mask);
+  while (mask) {
+    uns i = __builtin_ctzll(mask);
+    Cache_Line *line = cache_way_line<SKEWED>(c, set_index, lineaddr, i);
+    if (smallest_cycle_count > line->last_access_time) {
+      smallest_cycle_count = line->last_access_time;
+      victim = i;
+    }
+    mask &= mask - 1;
+  }
+  return victim;
+}
+
+template <Flag MASKED, uns64 POLICY, Flag SKEWED>
+static void cache_install_tmpl(Cache *c, uns set_index, Addr lineaddr, uns is_write, uns core_id){
+  uns victim_index = c->num_ways;
+  uns64 candidates = MASKED ? c->way_mask[core_id] : (1ULL << c->num_ways) - 1;
+
+  // check if space is avaliable in a given set_index
+  while (candidates) {
+    uns i = __builtin_ctzll(candidates);
+    if (cache_way_line<SKEWED>(c, set_index, lineaddr, i)->valid == false) {
+      victim_index = i;
+      break;
+    }
+    candidates &= candidates - 1;
   }
 
   // At this point all the Cache-lines in the set are valid and we have to evict a line
   // to replace it with new one.
-  if(victim_index == c->num_ways) { // Check this condition for PART: E.. would it be still the same?
-                                    // yes, 'num_ways' is just a flag here which is used to check if 
-                                    // 'victim_index' has been assigned any value.. it will not be assigned
-                                    // 'c->num_ways' anyway. So if it's value is still 'c->num_ways' all cache
-                                    // lines in their respective sets are filled.
-    victim_index = cache_find_victim (c, set_index, core_id); // Got the addr of the victim(evicted-line)
-    if (c->sets[set_index].line[victim_index].dirty) { //If line getting evicted is dirty
-      // printf("c->sets[set_index].line[victim_index].core_id: %d\n", c->sets[set_index].line[victim_index].core_id);
-      // printf("core_id: %d\n", core_id);
-      // assert(c->sets[set_index].line[victim_index].core_id == core_id);
+  if (victim_index == c->num_ways) {
+    victim_index = cache_find_victim_tmpl<MASKED, POLICY, SKEWED>(c, set_index, lineaddr, core_id);
+    Cache_Line *victim = cache_way_line<SKEWED>(c, set_index, lineaddr, victim_index);
+    if (c->dbp) {
+      cache_dbp_evict(c, victim);
+    }
+    if (victim->dirty) { //If line getting evicted is dirty
       c->stat_dirty_evicts++;
-    // printf("Cycle: %lu \t In: %s \t c->stat_dirty_evicts: %lu \n", cycle, __func__, c->stat_dirty_evicts);
-      // printf("@Cycle: %lu \t stat_dirty_evicts: %lu\n", cycle, c->stat_dirty_evicts);
     }
 
     // Initialize the evicted entry
-    c->last_evicted_line = c->sets[set_index].line[victim_index];
+    c->last_evicted_line = *victim;
   } else {
     c->last_evicted_line.valid = false;
   }
@@ -200,99 +670,293 @@ void cache_install(Cache *c, Addr lineaddr, uns is_write, uns core_id){
   assert (victim_index != c->num_ways); // This should not happen..
 
   // Now insert the new line..
-  c->sets[set_index].line[victim_index].valid = TRUE;
-  // Initialize the victim entry
-  c->sets[set_index].line[victim_index].tag = lineaddr;
-  c->sets[set_index].line[victim_index].dirty = is_write; // check if it's correct.
-  // Update the stats
-  c->sets[set_index].line[victim_index].last_access_time = cycle;
-  // update core-id as well
-  c->sets[set_index].line[victim_index].core_id = core_id;
-
+  Cache_Line *line = cache_way_line<SKEWED>(c, set_index, lineaddr, victim_index);
+  line->valid = TRUE;
+  line->tag = lineaddr;
+  line->dirty = is_write;
+  line->last_access_time = cycle;
+  line->core_id = core_id;
+  line->dbp_pred = FALSE;
+  line->dbp_dead = FALSE;
+  if (c->dbp && !is_write) {
+    cache_dbp_touch(c, line, core_id);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////
-// You may find it useful to split victim selection from install
+// Packed metadata. Each line is one word holding valid, dirty, core,
+// an LRU rank and the line address with the index bits dropped; the
+// full address is rebuilt from the set only on eviction, so
+// last_evicted_line keeps its Cache_Line form. Recency is a rank
+// permutation per set (exact access order) rather than a cycle
+// stamp, so lines touched in the same cycle may age differently
+// from the unpacked LRU. Needs a power-of-two, unskewed index.
 ////////////////////////////////////////////////////////////////////
 
-// Check: Return the address of the victim to be evicted
-// I think if should be the 'way' of the victim in the given
-// set to be evicted... i.e the index of the line.
-uns cache_find_victim(Cache *c, uns set_index, uns core_id){
-	uns victim=0; 
-  Flag L2_access = false;
-  if((c->num_ways == L2CACHE_ASSOC) && ((c->num_ways*c->num_sets*CACHE_LINESIZE) == L2CACHE_SIZE)) {
-    L2_access = true;
-  }
-
-  if (L2_access) { // On L2 access
-    if(SWP_CORE0_WAYS == 0) { // If there is no Static Way Partition
-      victim = find_replacement(c, set_index, core_id, L2_access);
-    } else if (SWP_CORE0_WAYS) { // Scan through cache per core basis
-      victim = find_replacement(c, set_index, core_id, L2_access);
+void cache_enable_packing(Cache *c){
+  if ((c->num_sets & (c->num_sets - 1)) || c->skewed) {
+    printf("Packed metadata needs a power-of-two number of sets and no skew\n");
+    exit(-1);
+  }
+
+  c->packed = TRUE;
+  free(c->sets);
+  c->sets = NULL;
+  c->meta = cache_meta_alloc(c, c->num_sets >> c->sample_shift);
+  cache_bind_repl(c, c->repl.policy);
+}
+
+// every set starts as the rank permutation 0..num_ways-1
+static uns64 *cache_meta_alloc(Cache *c, uns64 num_sets){
+  uns64 *meta = (uns64 *) calloc (num_sets*c->num_ways, sizeof(uns64));
+  for (uns64 ii=0; ii<num_sets; ii++) {
+    for (uns k=0; k<c->num_ways; k++) {
+      meta[ii*c->num_ways + k] = (uns64)(k) << META_RANK_SHIFT;
     }
-  } else { // If icache/dcache which are per core.. scan through the entire cache
-           // there's no SWP_CORE0_WAYS restriction 
-    victim = find_replacement(c, set_index, core_id, L2_access);
-  }
-
-	return victim;
-}
-// Find replacement
-uns find_replacement(Cache *c, uns set_index, uns core_id, Flag L2_access) {
-  uns victim=0;
-  if(L2_access) {
-      // Implement replacement policies
-    if(SWP_CORE0_WAYS == 0) {
-      if (c->repl_policy) { // Random replacement policy
-        victim = rand() % (c->num_ways);
-      } else { // LRU
-        uns smallest_cycle_count = cycle; 
-        // Looping over all the ways to find the minimum time
-        for (uns i=0; i<c->num_ways; i++) {
-          if (smallest_cycle_count > c->sets[set_index].line[i].last_access_time) {
-            smallest_cycle_count = c->sets[set_index].line[i].last_access_time;
-            victim = i;
-          }
-        }
-      }
-    } else if (SWP_CORE0_WAYS) { // We are only following LRU in case of StaticWayPartition
-      // your code goes heres
-      if(core_id == 0) {
-        uns64 smallest_cycle_count = cycle;
-        // Find the LRU in core'0 alloted ways in the given set.
-        for(uns i=0; i<SWP_CORE0_WAYS; i++) {
-          if (smallest_cycle_count > c->sets[set_index].line[i].last_access_time) {
-            smallest_cycle_count = c->sets[set_index].line[i].last_access_time;
-            victim = i;
-          }        
-        }
-      } else if(core_id == 1) {
-        uns64 smallest_cycle_count = cycle;
-        // Find the LRU in core1's alloted ways in the given set.
-        for(uns i=SWP_CORE0_WAYS; i<c->num_ways; i++) {
-          if (smallest_cycle_count > c->sets[set_index].line[i].last_access_time) {
-            smallest_cycle_count = c->sets[set_index].line[i].last_access_time;
-            victim = i;
-          }          
-        }
-      }
+  }
+  return meta;
+}
+
+static inline uns64 *cache_meta_set(Cache *c, uns set_index){
+  return &c->meta[(uns64)(set_index)*c->num_ways];
+}
+
+static inline uns64 cache_meta_key(Cache *c, Addr lineaddr, uns core_id){
+  return META_VALID | ((uns64)(core_id) << META_CORE_SHIFT) |
+         ((lineaddr >> c->index_bits) << META_TAG_SHIFT);
+}
+
+// make 'way' the MRU line, ageing the ones that were more recent
+static inline void cache_meta_touch(uns64 *set, uns num_ways, uns way){
+  uns64 rank = set[way] & (META_RANK_MASK << META_RANK_SHIFT);
+  for (uns k=0; k<num_ways; k++) {
+    if ((set[k] & (META_RANK_MASK << META_RANK_SHIFT)) < rank) {
+      set[k] += 1ULL << META_RANK_SHIFT;
     }
-  } else { // Access to private icache/dcache.. 
-    if (c->repl_policy) { // Random replacement policy
-      victim = rand() % (c->num_ways);
-    } else { // LRU
-      uns smallest_cycle_count = cycle; 
-      // Looping over all the ways to find the minimum time
-      for (uns i=0; i<c->num_ways; i++) {
-        if (smallest_cycle_count > c->sets[set_index].line[i].last_access_time) {
-          smallest_cycle_count = c->sets[set_index].line[i].last_access_time;
-          victim = i;
-        }
+  }
+  set[way] &= ~(META_RANK_MASK << META_RANK_SHIFT);
+}
+
+// Cache_Line view of a packed line of (dense) set_index
+static Cache_Line cache_meta_unpack(Cache *c, uns set_index, uns64 word){
+  Cache_Line line;
+  uns   b   = c->index_bits;
+  uns64 tag = word >> META_TAG_SHIFT;
+  uns64 low = (uns64)(set_index) << c->sample_shift;
+
+  if (c->index_type == CACHE_INDEX_XOR) { // undo the fold, see cache_index_xor
+    low ^= (tag ^ (tag >> b) ^ (tag >> 2*b)) & c->set_mask;
+  }
+
+  line.valid   = (word & META_VALID) ? TRUE : FALSE;
+  line.dirty   = (word & META_DIRTY) ? TRUE : FALSE;
+  line.tag     = (tag << b) | low;
+  line.core_id = (word >> META_CORE_SHIFT) & META_CORE_MASK;
+  line.last_access_time = 0;
+  return line;
+}
+
+static Flag cache_access_packed(Cache *c, uns set_index, Addr lineaddr, uns is_write, uns core_id){
+  uns64 *set  = cache_meta_set(c, set_index);
+  uns64 key   = cache_meta_key(c, lineaddr, core_id);
+  uns64 match = ~(META_DIRTY | (META_RANK_MASK << META_RANK_SHIFT));
+
+  for (uns k=0; k<c->num_ways; k++) {
+    if ((set[k] & match) == key) {
+      cache_meta_touch(set, c->num_ways, k);
+      if (is_write) {
+        set[k] |= META_DIRTY;
       }
+      return HIT;
+    }
+  }
+  return MISS;
+}
+
+static Flag cache_invalidate_packed(Cache *c, uns set_index, Addr lineaddr, uns core_id, Flag *was_dirty){
+  uns64 *set  = cache_meta_set(c, set_index);
+  uns64 key   = cache_meta_key(c, lineaddr, core_id);
+  uns64 match = ~(META_DIRTY | (META_RANK_MASK << META_RANK_SHIFT));
+
+  for (uns k=0; k<c->num_ways; k++) {
+    if ((set[k] & match) == key) {
+      *was_dirty = (set[k] & META_DIRTY) ? TRUE : FALSE;
+      set[k] &= ~(META_VALID | META_DIRTY);
+      return HIT;
     }
   }
+  return MISS;
+}
+
+static Flag cache_probe_packed(Cache *c, uns set_index, Addr lineaddr, uns core_id){
+  uns64 *set  = cache_meta_set(c, set_index);
+  uns64 key   = cache_meta_key(c, lineaddr, core_id);
+  uns64 match = ~(META_DIRTY | (META_RANK_MASK << META_RANK_SHIFT));
+
+  for (uns k=0; k<c->num_ways; k++) {
+    if ((set[k] & match) == key) {
+      return HIT;
+    }
+  }
+  return MISS;
+}
+
+template <Flag MASKED, uns64 POLICY>
+static uns cache_find_victim_packed_tmpl(Cache *c, uns set_index, Addr lineaddr, uns core_id){
+  uns64 *set  = cache_meta_set(c, set_index);
+  uns64 mask  = MASKED ? c->way_mask[core_id] : (1ULL << c->num_ways) - 1;
+
+  if (POLICY == REPL_RAND) {
+    return cache_random_way(mask);
+  }
 
+  // LRU: the allowed way with the highest rank
+  uns   victim = __builtin_ctzll(mask);
+  uns64 oldest = 0;
+  while (mask) {
+    uns i = __builtin_ctzll(mask);
+    uns64 rank = set[i] & (META_RANK_MASK << META_RANK_SHIFT);
+    if (rank > oldest) {
+      oldest = rank;
+      victim = i;
+    }
+    mask &= mask - 1;
+  }
   return victim;
 }
 
+template <Flag MASKED, uns64 POLICY>
+static void cache_install_packed_tmpl(Cache *c, uns set_index, Addr lineaddr, uns is_write, uns core_id){
+  uns64 *set = cache_meta_set(c, set_index);
+  uns victim_index = c->num_ways;
+  uns64 candidates = MASKED ? c->way_mask[core_id] : (1ULL << c->num_ways) - 1;
+
+  assert(((lineaddr >> c->index_bits) >> META_TAG_BITS) == 0);
+
+  while (candidates) {
+    uns i = __builtin_ctzll(candidates);
+    if (!(set[i] & META_VALID)) {
+      victim_index = i;
+      break;
+    }
+    candidates &= candidates - 1;
+  }
+
+  if (victim_index == c->num_ways) {
+    victim_index = cache_find_victim_packed_tmpl<MASKED, POLICY>(c, set_index, lineaddr, core_id);
+    if (set[victim_index] & META_DIRTY) {
+      c->stat_dirty_evicts++;
+    }
+    c->last_evicted_line = cache_meta_unpack(c, set_index, set[victim_index]);
+  } else {
+    c->last_evicted_line.valid = false;
+  }
+
+  set[victim_index] = (set[victim_index] & (META_RANK_MASK << META_RANK_SHIFT)) |
+                      cache_meta_key(c, lineaddr, core_id) | (is_write ? META_DIRTY : 0);
+  cache_meta_touch(set, c->num_ways, victim_index);
+}
+
+template <Flag MASKED, uns64 POLICY>
+static void cache_bind_repl_tmpl(Cache *c){
+  if (c->packed) {
+    c->repl.find_victim = cache_find_victim_packed_tmpl<MASKED, POLICY>;
+    c->repl.install     = cache_install_packed_tmpl<MASKED, POLICY>;
+  } else if (c->skewed) {
+    c->repl.find_victim = cache_find_victim_tmpl<MASKED, POLICY, TRUE>;
+    c->repl.install     = cache_install_tmpl<MASKED, POLICY, TRUE>;
+  } else {
+    c->repl.find_victim = cache_find_victim_tmpl<MASKED, POLICY, FALSE>;
+    c->repl.install     = cache_install_tmpl<MASKED, POLICY, FALSE>;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Pick the specialized routines for this cache. Any policy other
+// than RAND replaces by LRU; on the L2 that is done within way masks.
+////////////////////////////////////////////////////////////////////
+
+static void cache_bind_repl(Cache *c, uns64 repl_policy){
+  Flag masked = (c->level == CACHE_LEVEL_L2);
+  Flag rnd    = (repl_policy == REPL_RAND);
+
+  c->repl.policy = rnd ? REPL_RAND : REPL_LRU;
+
+  if (masked && rnd) {
+    cache_bind_repl_tmpl<TRUE, REPL_RAND>(c);
+  }
+  if (masked && !rnd) {
+    cache_bind_repl_tmpl<TRUE, REPL_LRU>(c);
+  }
+  if (!masked && rnd) {
+    cache_bind_repl_tmpl<FALSE, REPL_RAND>(c);
+  }
+  if (!masked && !rnd) {
+    cache_bind_repl_tmpl<FALSE, REPL_LRU>(c);
+  }
+}
+
+template <Cache_Index_Fn INDEX>
+static void cache_bind_index_tmpl(Cache *c){
+  c->index.set        = cache_index_tmpl<INDEX>;
+  c->index.access     = cache_access_idx<INDEX>;
+  c->index.invalidate = cache_invalidate_idx<INDEX>;
+  c->index.probe      = cache_probe_idx<INDEX>;
+  c->index.install    = cache_install_idx<INDEX>;
+}
+
+// a one-set "skewed" cache has nothing to skew: bound as MASK
+static void cache_bind_index(Cache *c){
+  if (c->index_type == CACHE_INDEX_MOD) {
+    cache_bind_index_tmpl<CACHE_INDEX_MOD>(c);
+  }
+  if ((c->index_type == CACHE_INDEX_MASK) || ((c->index_type == CACHE_INDEX_SKEW) && !c->skewed)) {
+    cache_bind_index_tmpl<CACHE_INDEX_MASK>(c);
+  }
+  if (c->index_type == CACHE_INDEX_XOR) {
+    cache_bind_index_tmpl<CACHE_INDEX_XOR>(c);
+  }
+  if (c->skewed) {
+    cache_bind_index_tmpl<CACHE_INDEX_SKEW>(c);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Restrict the ways core_id may allocate into. Lines already resident
+// outside the mask still hit; they age out as other cores replace them.
+////////////////////////////////////////////////////////////////////
+
+void cache_set_way_mask(Cache *c, uns core_id, uns64 mask){
+  assert(c->level == CACHE_LEVEL_L2); // only the shared level is partitioned
+  assert(core_id < MAX_CORES);
+  mask &= (1ULL << c->num_ways) - 1;
+  assert(mask != 0);
+  c->way_mask[core_id] = mask;
+}
+
+////////////////////////////////////////////////////////////////////
+// Class-of-service interface (CAT style): cores are grouped into
+// classes and a class mask change takes effect for all its members
+// from the next install. A direct cache_set_way_mask() on a core
+// holds until its class is touched again.
+////////////////////////////////////////////////////////////////////
+
+void cache_set_clos_mask(Cache *c, uns clos, uns64 mask){
+  assert(clos < MAX_CLOS);
+  mask &= (1ULL << c->num_ways) - 1;
+  assert(mask != 0);
+  c->clos_mask[clos] = mask;
+
+  for(uns ii=0; ii<MAX_CORES; ii++){
+    if(c->core_clos[ii] == clos){
+      c->way_mask[ii] = mask;
+    }
+  }
+}
+
+void cache_set_core_clos(Cache *c, uns core_id, uns clos){
+  assert(core_id < MAX_CORES);
+  assert(clos < MAX_CLOS);
+  c->core_clos[core_id] = clos;
+  c->way_mask[core_id] = c->clos_mask[clos];
+}
@@ -2,12 +2,49 @@
 #define CACHE_H
 
 #include "types.h"
+#include "missclass.h"
+#include "deadblock.h"
 
 #define MAX_WAYS 16
+#define MAX_CLOS 16 // classes of service for way-mask allocation
+#define CACHE_SAMPLE_WINDOW 128 // accesses (to all sets) the unsampled sets' draws average over
+
+// Replacement policies (REPL_POLICY / L2CACHE_REPL)
+#define REPL_LRU  0
+#define REPL_RAND 1
+#define REPL_SWP  2
+#define REPL_UCP  3
+
+// Packed line metadata (cache_enable_packing): one 64-bit word per
+// line instead of a 24-byte Cache_Line, for very large caches
+#define META_VALID       (1ULL<<0)
+#define META_DIRTY       (1ULL<<1)
+#define META_CORE_SHIFT  2
+#define META_CORE_MASK   0xFULL   // MAX_CORES
+#define META_RANK_SHIFT  6
+#define META_RANK_MASK   0xFULL   // LRU rank within the set, 0 is MRU (MAX_WAYS)
+#define META_TAG_SHIFT   10       // partial tag: line address above the index bits
+#define META_TAG_BITS    54
 
 typedef struct Cache_Line Cache_Line;
 typedef struct Cache_Set Cache_Set;
 typedef struct Cache Cache;
+typedef struct Cache_Repl Cache_Repl;
+typedef struct Cache_Index Cache_Index;
+
+// Where a cache sits, fixed at cache_new
+typedef enum Cache_Level_Enum {
+    CACHE_LEVEL_L1=1,    // private to one core: the whole set is replaceable
+    CACHE_LEVEL_L2=2,    // shared: replacement honours the per-core way masks
+} Cache_Level;
+
+// Set index functions, picked once per cache (cache_set_index_fn)
+typedef enum Cache_Index_Fn_Enum {
+    CACHE_INDEX_MOD=0,   // lineaddr % num_sets, any number of sets
+    CACHE_INDEX_MASK=1,  // low bits, power-of-two sets (default when possible)
+    CACHE_INDEX_XOR=2,   // low bits XOR folded tag bits
+    CACHE_INDEX_SKEW=3,  // skewed associative: per-way hash of the tag
+} Cache_Index_Fn;
 
 //////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////
@@ -16,6 +53,9 @@ typedef struct Cache Cache;
 struct Cache_Line {
     Flag    valid;
     Flag    dirty;
+    Flag    dbp_pred;         // dead block prediction made at the last read
+    Flag    dbp_dead;
+    uns16   dbp_sig;          // signature of that read
     Addr    tag;
     uns     core_id;
     uns    last_access_time; // for LRU
@@ -28,36 +68,120 @@ struct Cache_Set {
 };
 
 
+// Replacement policy, bound once at cache_new to the install/victim
+// routines specialized for this policy and level
+struct Cache_Repl {
+  uns64 policy;   // REPL_LRU or REPL_RAND (SWP/UCP are LRU in masked ways)
+  uns   (*find_victim)(Cache *c, uns set_index, Addr lineaddr, uns core_id);
+  void  (*install)(Cache *c, uns set_index, Addr lineaddr, uns is_write, uns core_id);
+};
+
+
+// Set indexing, bound by cache_set_index_fn to the lookup routines
+// specialized for this index function, so neither the index nor the
+// per-way skew is chosen again on each access
+struct Cache_Index {
+  uns64 (*set)(Cache *c, Addr lineaddr);
+  Flag  (*access)(Cache *c, Addr lineaddr, uns is_write, uns core_id);
+  Flag  (*invalidate)(Cache *c, Addr lineaddr, uns core_id, Flag *was_dirty);
+  Flag  (*probe)(Cache *c, Addr lineaddr, uns core_id);
+  void  (*install)(Cache *c, Addr lineaddr, uns is_write, uns core_id);
+};
+
+
 struct Cache{
   uns64 num_sets;
   uns64 num_ways;
-  uns64 repl_policy;
+  Cache_Level level;
+  Cache_Repl  repl;
   
   Cache_Set *sets;
   Cache_Line last_evicted_line; // for checking writebacks
 
+  // packed metadata replaces sets[] when enabled
+  Flag   packed;
+  uns64 *meta;          // meta[set*num_ways + way]
+
+  // set indexing
+  Cache_Index_Fn index_type;
+  Cache_Index    index;
+  uns   index_bits;
+  uns64 set_mask;
+  Flag  skewed;         // way_skew[] in use
+  uns64 skew_mask;
+  uns   skew_shift;
+  uns64 way_skew[MAX_WAYS];
+
+  uns64 way_mask[MAX_CORES]; // ways each core may allocate into (L2 partitioning)
+  uns64 clos_mask[MAX_CLOS];  // way mask of each class of service
+  uns   core_clos[MAX_CORES]; // class of service of each core
+
+  // set sampling: only 1 in sample_ratio sets keeps tag state
+  uns64 sample_ratio;
+  uns64 sample_shift;
+  uns64 *sample_set_access; // per sampled set, for the confidence interval
+  uns64 *sample_set_miss;
+
+  // Recent sampled-set behaviour of each core that the unsampled sets
+  // draw their outcomes from: moving averages over about the last
+  // CACHE_SAMPLE_WINDOW accesses, negative until the first sample
+  double sample_miss_rate[MAX_CORES][2]; // [core][is_write]
+  double sample_dirty_rate[MAX_CORES];   // dirty victims per install
+  double sample_alpha;  // weight of a sample: sample_ratio/CACHE_SAMPLE_WINDOW
+  uns64 sample_rng;     // private, so rand() stays with random replacement
+
+  Miss_Class *mclass;   // three-C miss classification, when enabled
+  Dead_Block *dbp;      // dead block predictor, when enabled
+  Addr   access_pc;     // PC of the access in flight, for the predictor
+
   //stats
   uns64 stat_read_access; 
   uns64 stat_write_access; 
   uns64 stat_read_miss; 
   uns64 stat_write_miss; 
   uns64 stat_dirty_evicts; // how many dirty lines were evicted?
+
+  // sampled-set stats (sample_ratio > 1)
+  uns64 stat_sampled_read_access;
+  uns64 stat_sampled_write_access;
+  uns64 stat_sampled_read_miss;
+  uns64 stat_sampled_write_miss;
 };
 
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////
 
-Cache  *cache_new(uns64 size, uns64 assocs, uns64 linesize, uns64 repl_policy);
+Cache  *cache_new(uns64 size, uns64 assocs, uns64 linesize, uns64 repl_policy, Cache_Level level);
 Flag    cache_access         (Cache *c, Addr lineaddr, uns is_write, uns core_id);
-Flag    check_umon           (Cache *c, Addr lineaddr, uns is_write, uns core_id);
 void    cache_install        (Cache *c, Addr lineaddr, uns is_write, uns core_id);
-void    umon_install         (Cache *c, Addr lineaddr, uns is_write, uns core_id);
+Flag    cache_invalidate     (Cache *c, Addr lineaddr, uns core_id, Flag *was_dirty);
+Flag    cache_probe          (Cache *c, Addr lineaddr, uns core_id);
 void    cache_print_stats    (Cache *c, char *header);
-
-uns     cache_find_victim    (Cache *c, uns set_index, uns core_id);
-
-uns     find_replacement  (Cache *c, uns set_index, uns core_id, Flag L2_access);
+void    cache_print_sampling_stats(Cache *c, char *header);
+Flag    cache_sampled_outcome(Cache *c, uns is_write, uns core_id);
+
+uns     cache_find_victim    (Cache *c, uns set_index, Addr lineaddr, uns core_id);
+void    cache_set_index_fn   (Cache *c, Cache_Index_Fn index_fn);
+uns64   cache_set_index      (Cache *c, Addr lineaddr);
+void    cache_set_way_mask   (Cache *c, uns core_id, uns64 mask);
+void    cache_enable_sampling(Cache *c, uns64 sample_ratio);
+void    cache_enable_packing (Cache *c);
+void    cache_enable_miss_class(Cache *c);
+void    cache_enable_dbp     (Cache *c, uns mode);
+void    cache_set_clos_mask  (Cache *c, uns clos, uns64 mask);
+void    cache_set_core_clos  (Cache *c, uns core_id, uns clos);
+
+// Line held by 'way' for the access that maps to set_index: the set
+// is the same in every way unless the cache is skewed
+template <Flag SKEWED>
+static inline Cache_Line *cache_way_line(Cache *c, uns64 set_index, Addr lineaddr, uns way){
+  if(!SKEWED){
+    return &c->sets[set_index].line[way];
+  }
+  uns64 skew = ((lineaddr >> c->index_bits) * c->way_skew[way]) >> c->skew_shift;
+  return &c->sets[(set_index ^ skew) & c->skew_mask].line[way];
+}
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////
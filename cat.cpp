@@ -0,0 +1,169 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cat.h"
+
+extern void die_message(const char * msg);
+
+static CAT_Event *cat_events;
+static uns        cat_num_events;
+static uns        cat_max_events;
+static uns        cat_next_event; // events before this one were applied
+
+
+///////////////////////////////////////////////////////////////////
+// Events are kept sorted by cycle, file order among equal cycles
+///////////////////////////////////////////////////////////////////
+
+static void cat_add_event(CAT_Event *ev){
+  if(cat_num_events == cat_max_events){
+    cat_max_events = cat_max_events ? 2*cat_max_events : 16;
+    cat_events = (CAT_Event *) realloc (cat_events, cat_max_events*sizeof(CAT_Event));
+  }
+
+  uns pos = cat_num_events;
+  while((pos > cat_next_event) && (cat_events[pos-1].cycle > ev->cycle)){
+    cat_events[pos] = cat_events[pos-1];
+    pos--;
+  }
+  cat_events[pos] = *ev;
+  cat_num_events++;
+}
+
+///////////////////////////////////////////////////////////////////
+// Parse one schedule line, returns FALSE on a malformed line
+///////////////////////////////////////////////////////////////////
+
+Flag    cat_parse_line(const char *line){
+  char  buf[256];
+  char *tok[5];
+  uns   num_tok = 0;
+  CAT_Event ev;
+
+  strncpy(buf, line, sizeof(buf)-1);
+  buf[sizeof(buf)-1] = 0;
+
+  char *comment = strchr(buf, '#');
+  if(comment){
+    *comment = 0;
+  }
+
+  for(char *t = strtok(buf, " \t\r\n"); t; t = strtok(NULL, " \t\r\n")){
+    if(num_tok == 5){
+      return FALSE;
+    }
+    tok[num_tok++] = t;
+  }
+
+  if(num_tok == 0){
+    return TRUE; // blank line
+  }
+
+  ev.cycle = 0;
+  if(tok[0][0] == '@'){
+    ev.cycle = strtoull(tok[0]+1, NULL, 0);
+    memmove(&tok[0], &tok[1], (num_tok-1)*sizeof(char *));
+    num_tok--;
+  }
+
+  if((num_tok == 3) && !strcmp(tok[0], "clos")){
+    ev.type  = CAT_EVENT_CLOS_MASK;
+    ev.id    = atoi(tok[1]);
+    ev.value = strtoull(tok[2], NULL, 0);
+    if(ev.id >= MAX_CLOS){
+      return FALSE;
+    }
+  }
+  else if((num_tok == 4) && !strcmp(tok[0], "core") && !strcmp(tok[2], "clos")){
+    ev.type  = CAT_EVENT_CORE_CLOS;
+    ev.id    = atoi(tok[1]);
+    ev.value = strtoull(tok[3], NULL, 0);
+    if((ev.id >= MAX_CORES) || (ev.value >= MAX_CLOS)){
+      return FALSE;
+    }
+  }
+  else if((num_tok == 4) && !strcmp(tok[0], "core") && !strcmp(tok[2], "mask")){
+    ev.type  = CAT_EVENT_CORE_MASK;
+    ev.id    = atoi(tok[1]);
+    ev.value = strtoull(tok[3], NULL, 0);
+    if(ev.id >= MAX_CORES){
+      return FALSE;
+    }
+  }
+  else {
+    return FALSE;
+  }
+
+  if((ev.type != CAT_EVENT_CORE_CLOS) && (ev.value == 0)){
+    return FALSE; // a class with no ways cannot allocate
+  }
+
+  cat_add_event(&ev);
+  return TRUE;
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+void    cat_load_config(const char *fname){
+  char line[256];
+  char msg[512];
+  uns  lineno = 0;
+  FILE *fp = fopen(fname, "r");
+
+  if(fp == NULL){
+    snprintf(msg, sizeof(msg), "Unable to open way-mask config %s", fname);
+    die_message(msg);
+  }
+
+  while(fgets(line, sizeof(line), fp)){
+    lineno++;
+    if(!cat_parse_line(line)){
+      snprintf(msg, sizeof(msg), "Bad way-mask config line %u in %s", lineno, fname);
+      die_message(msg);
+    }
+  }
+
+  fclose(fp);
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+Flag    cat_configured(void){
+  return (cat_num_events != 0);
+}
+
+///////////////////////////////////////////////////////////////////
+// Apply every event due at or before 'now' to the cache. Returns
+// the cycle of the next pending event, so callers only need to
+// come back when cycle reaches it.
+///////////////////////////////////////////////////////////////////
+
+uns64   cat_apply(Cache *c, uns64 now){
+  while((cat_next_event < cat_num_events) && (cat_events[cat_next_event].cycle <= now)){
+    CAT_Event *ev = &cat_events[cat_next_event];
+
+    if((ev->type != CAT_EVENT_CORE_CLOS) && !(ev->value & ((1ULL << c->num_ways) - 1))){
+      die_message("Way mask selects no ways of the L2");
+    }
+
+    if(ev->type == CAT_EVENT_CLOS_MASK){
+      cache_set_clos_mask(c, ev->id, ev->value);
+    }
+    if(ev->type == CAT_EVENT_CORE_CLOS){
+      cache_set_core_clos(c, ev->id, (uns)(ev->value));
+    }
+    if(ev->type == CAT_EVENT_CORE_MASK){
+      cache_set_way_mask(c, ev->id, ev->value);
+    }
+    cat_next_event++;
+  }
+
+  if(cat_next_event < cat_num_events){
+    return cat_events[cat_next_event].cycle;
+  }
+  return CAT_NO_EVENT;
+}
@@ -0,0 +1,53 @@
+#ifndef CAT_H
+#define CAT_H
+
+#include "types.h"
+#include "cache.h"
+
+#define CAT_NO_EVENT  (~0ULL)
+
+typedef struct CAT_Event CAT_Event;
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+// Way-mask allocation schedule for the shared L2 (Intel CAT style).
+// Each event sets a class mask, moves a core to a class, or sets a
+// core's mask directly, at a given cycle. Events come from -L2mask
+// options and from a config file with one event per line:
+//
+//   # comment
+//   [@<cycle>] clos <clos> <mask>
+//   [@<cycle>] core <core> clos <clos>
+//   [@<cycle>] core <core> mask <mask>
+//
+// Masks are read with strtoull base 0, so 0x00ff and 255 both work.
+// Events without an @cycle apply before the first access.
+
+typedef enum CAT_Event_Type_Enum {
+    CAT_EVENT_CLOS_MASK=0,
+    CAT_EVENT_CORE_CLOS=1,
+    CAT_EVENT_CORE_MASK=2,
+} CAT_Event_Type;
+
+struct CAT_Event {
+  uns64          cycle;
+  CAT_Event_Type type;
+  uns            id;     // clos or core
+  uns64          value;  // mask or clos
+};
+
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Flag    cat_parse_line(const char *line);
+void    cat_load_config(const char *fname);
+Flag    cat_configured(void);
+uns64   cat_apply(Cache *c, uns64 now);
+
+
+
+
+#endif // CAT_H
@@ -8,6 +8,9 @@
 #include "core.h"
 
 extern uns64 cycle;
+extern uns64 CORE_ROB_SIZE;
+extern uns64 CORE_WIDTH;
+extern uns64 CORE_MSHRS;
 
 extern void die_message(const char * msg);
 
@@ -21,6 +24,13 @@ Core *core_new(Memsys *memsys, char *trace_fname, uns core_id)
   c->core_id = core_id;
   c->memsys  = memsys;
 
+  if(memsys && CORE_ROB_SIZE){
+    c->rob_size = CORE_ROB_SIZE;
+    c->rob      = (uns64 *) calloc (c->rob_size, sizeof(uns64));
+    c->mshr_size = CORE_MSHRS;
+    c->mshr      = (uns64 *) calloc (c->mshr_size, sizeof(uns64));
+  }
+
   strcpy(c->trace_fname, trace_fname);
   core_init_trace(c);
   core_read_trace(c);
@@ -43,6 +53,133 @@ void core_init_trace(Core *c)
   
 }
 
+////////////////////////////////////////////////////////////////////
+// Miss overlap: misses take their MSHRs in dispatch order, and one
+// that has to wait starts no earlier than those before it, so the
+// cycles covered by at least one miss grow from the right end only
+////////////////////////////////////////////////////////////////////
+
+static void core_note_miss(Core *c, uns mshr, uns64 start, uns64 end){
+  c->mshr[mshr] = end;
+  c->stat_load_miss++;
+  c->stat_miss_cycles += end - start;
+  if(start >= c->miss_busy_end){
+    c->stat_miss_busy += end - start;
+    c->miss_busy_end   = end;
+  } else if(end > c->miss_busy_end){
+    c->stat_miss_busy += end - c->miss_busy_end;
+    c->miss_busy_end   = end;
+  }
+}
+
+// MSHR for a load that missed: a free one, else the one that frees
+// up first
+static uns core_mshr(Core *c){
+  uns first = 0;
+  for(uns ii=0; ii<c->mshr_size; ii++){
+    if(c->mshr[ii] <= cycle){
+      return ii;
+    }
+    if(c->mshr[ii] < c->mshr[first]){
+      first = ii;
+    }
+  }
+  return first;
+}
+
+////////////////////////////////////////////////////////////////////
+// Retire up to CORE_WIDTH finished instructions in order, then fetch
+// and dispatch up to CORE_WIDTH new ones. Loads go to the memory
+// system at dispatch and finish when their latency has elapsed. A
+// load that would miss while every MSHR is busy holds dispatch until
+// the first one frees up, and is sent then; hits never wait.
+////////////////////////////////////////////////////////////////////
+
+static void core_cycle_ooo(Core *c)
+{
+  for(uns ii=0; (ii<CORE_WIDTH) && c->rob_count; ii++){
+    if(c->rob[c->rob_head] > cycle){
+      break;
+    }
+    c->rob_head = (c->rob_head+1) % c->rob_size;
+    c->rob_count--;
+  }
+
+  if(c->trace_done){
+    if(c->rob_count == 0){
+      c->done=TRUE;
+      c->done_inst_count  = c->inst_count;
+      c->done_cycle_count = cycle;
+      memsys_wbb_flush(c->memsys, c->core_id);
+    }
+    return;
+  }
+
+  if(cycle <= c->snooze_end_cycle){
+    return;
+  }
+
+  for(uns ii=0; (ii<CORE_WIDTH) && !c->trace_done; ii++){
+    if(c->rob_count == c->rob_size){
+      c->stat_rob_full_cycles++;
+      break;
+    }
+
+    // a load that will miss waits here for an MSHR, and only then
+    // goes to the memory system
+    if(c->trace_inst_type==INST_TYPE_LOAD){
+      uns mshr = core_mshr(c);
+      if((c->mshr[mshr] > cycle) &&
+         (memsys_load_hits(c->memsys, c->trace_ldst_addr, c->core_id) == MISS)){
+        c->stat_mshr_full++;
+        c->snooze_end_cycle = c->mshr[mshr]-1;
+        break;
+      }
+    }
+
+    uns64 done_cycle = cycle+1;
+    uns   bubble_cycles = 0;
+
+    c->inst_count++;
+
+    uns ifetch_delay = memsys_access(c->memsys, c->trace_inst_addr, ACCESS_TYPE_IFETCH, c->core_id, c->trace_inst_addr);
+    if(ifetch_delay>1){
+      bubble_cycles += (ifetch_delay-1);
+    }
+
+    if(c->trace_inst_type==INST_TYPE_LOAD){
+      uns ld_delay = memsys_access(c->memsys, c->trace_ldst_addr, ACCESS_TYPE_LOAD, c->core_id, c->trace_inst_addr);
+      done_cycle = cycle + ld_delay;
+      if(ld_delay>1){
+        uns   mshr  = core_mshr(c);
+        uns64 start = cycle;
+        if(c->mshr[mshr] > cycle){ // a DCACHE hit slowed by a TLB miss
+          c->stat_mshr_full++;
+          start = c->mshr[mshr];
+        }
+        done_cycle = start + ld_delay;
+        core_note_miss(c, mshr, start, done_cycle);
+      }
+    }
+
+    if(c->trace_inst_type==INST_TYPE_STORE){
+      memsys_access(c->memsys, c->trace_ldst_addr, ACCESS_TYPE_STORE, c->core_id, c->trace_inst_addr);
+      bubble_cycles += memsys_wbb_store_stall(c->memsys, c->core_id);
+    }
+
+    c->rob[(c->rob_head + c->rob_count) % c->rob_size] = done_cycle;
+    c->rob_count++;
+
+    core_read_trace(c);
+
+    // fetch resumes after an icache miss or a full writeback buffer
+    if(bubble_cycles){
+      c->snooze_end_cycle = (cycle+bubble_cycles);
+      break;
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////
 
@@ -52,6 +189,11 @@ void core_cycle (Core *c)
     return;
   }
 
+  if(c->rob){
+    core_cycle_ooo(c);
+    return;
+  }
+
   // if core is snoozing on DRAM hits, return ..
   if(cycle <= c->snooze_end_cycle){
       return;
@@ -61,20 +203,22 @@ void core_cycle (Core *c)
 
   uns ifetch_delay=0, ld_delay=0, st_delay=0, bubble_cycles=0;
 	
-  ifetch_delay = memsys_access(c->memsys, c->trace_inst_addr, ACCESS_TYPE_IFETCH, c->core_id);
+  ifetch_delay = memsys_access(c->memsys, c->trace_inst_addr, ACCESS_TYPE_IFETCH, c->core_id, c->trace_inst_addr);
   if(ifetch_delay>1){
     bubble_cycles += (ifetch_delay-1);
   }
 
   if(c->trace_inst_type==INST_TYPE_LOAD){
-    ld_delay = memsys_access(c->memsys, c->trace_ldst_addr, ACCESS_TYPE_LOAD, c->core_id);
+    ld_delay = memsys_access(c->memsys, c->trace_ldst_addr, ACCESS_TYPE_LOAD, c->core_id, c->trace_inst_addr);
   }
   if(ld_delay>1){
     bubble_cycles += (ld_delay-1);
   }
   
   if(c->trace_inst_type==INST_TYPE_STORE){
-    st_delay = memsys_access(c->memsys, c->trace_ldst_addr, ACCESS_TYPE_STORE, c->core_id);
+    st_delay = memsys_access(c->memsys, c->trace_ldst_addr, ACCESS_TYPE_STORE, c->core_id, c->trace_inst_addr);
+    // a store only waits when its dirty victim finds the writeback buffer full
+    bubble_cycles += memsys_wbb_store_stall(c->memsys, c->core_id);
   }
   //No bubbles for store misses
 
@@ -97,9 +241,16 @@ void core_read_trace (Core *c){
   tmp = fread (&c->trace_ldst_addr, 4, 1, c->trace);
   
   if(feof(c->trace)){
+    c->trace_done=TRUE;
+    if(c->rob){
+      return; // done once the ROB drains
+    }
     c->done=TRUE;
     c->done_inst_count  = c->inst_count;
     c->done_cycle_count = cycle;
+    if(c->memsys){
+      memsys_wbb_flush(c->memsys, c->core_id);
+    }
   }
   
 }
@@ -118,6 +269,26 @@ void core_print_stats(Core *c)
   printf("\n%s_CYCLES       \t\t : %10llu", header,  c->done_cycle_count);
   printf("\n%s_IPC          \t\t : %10.3f", header,  ipc);
 
+  if(c->rob){
+    printf("\n%s_ROB_FULL_PERC\t\t : %10.3f", header,
+           c->done_cycle_count ? 100*(double)(c->stat_rob_full_cycles)/(double)(c->done_cycle_count) : 0);
+    printf("\n%s_LOAD_MISS    \t\t : %10llu", header, c->stat_load_miss);
+    printf("\n%s_MSHR_FULL_PERC\t\t : %10.3f", header,
+           c->stat_load_miss ? 100*(double)(c->stat_mshr_full)/(double)(c->stat_load_miss) : 0);
+    printf("\n%s_MISS_BUSY_PERC\t\t : %10.3f", header,
+           c->done_cycle_count ? 100*(double)(c->stat_miss_busy)/(double)(c->done_cycle_count) : 0);
+    printf("\n%s_MLP          \t\t : %10.3f", header,
+           c->stat_miss_busy ? (double)(c->stat_miss_cycles)/(double)(c->stat_miss_busy) : 0);
+  }
+
+  TLB *tlb = c->memsys->tlb_coreid[c->core_id];
+  if(tlb && c->done_inst_count){
+    double kilo_inst = (double)(c->done_inst_count)/1000.0;
+    printf("\n%s_ITLB_MPKI    \t\t : %10.3f", header, (double)(tlb->itlb->stat_read_miss)/kilo_inst);
+    printf("\n%s_DTLB_MPKI    \t\t : %10.3f", header, (double)(tlb->dtlb->stat_read_miss)/kilo_inst);
+    printf("\n%s_STLB_MPKI    \t\t : %10.3f", header, (double)(tlb->stat_walks)/kilo_inst);
+  }
+
   pclose(c->trace);
 }
 
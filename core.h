@@ -31,6 +31,26 @@ struct Core {
   uns64 inst_count;
   uns64 done_inst_count;
   uns64 done_cycle_count;
+
+  // Out-of-order window (-rob N, off by default). The traces carry no
+  // register names, so every instruction is independent: a load waits
+  // only for its own data, and the ROB size alone bounds how many
+  // misses overlap, up to the number of MSHRs. Fetch stays in order
+  // and stalls on icache misses.
+  uns64 *rob;             // completion cycle of each entry, a ring
+  uns    rob_size;
+  uns    rob_head;
+  uns    rob_count;
+  uns64 *mshr;            // completion cycle of each outstanding miss
+  uns    mshr_size;
+  Flag   trace_done;      // trace exhausted, ROB still draining
+
+  uns64 stat_rob_full_cycles;
+  uns64 stat_load_miss;   // loads that took longer than an L1 hit
+  uns64 stat_mshr_full;   // ... and found every MSHR busy
+  uns64 stat_miss_cycles; // their latencies, summed
+  uns64 stat_miss_busy;   // cycles with at least one outstanding
+  uns64 miss_busy_end;
 };
 
 
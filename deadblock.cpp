@@ -0,0 +1,61 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "deadblock.h"
+
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+Dead_Block *dbp_new(uns mode){
+  Dead_Block *dbp = (Dead_Block *) calloc (1, sizeof (Dead_Block));
+  dbp->mode = mode;
+  return dbp;
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+static inline uns dbp_filter_index(Addr lineaddr){
+  return (uns)((lineaddr * 0xC2B2AE3D27D4EB4FULL) >> 40) & (DBP_FILTER_SIZE-1);
+}
+
+void    dbp_bypassed(Dead_Block *dbp, Addr lineaddr, uns16 sig){
+  uns ii = dbp_filter_index(lineaddr);
+  dbp->filter_tag[ii] = lineaddr+1;
+  dbp->filter_sig[ii] = sig;
+  dbp->stat_bypass++;
+}
+
+///////////////////////////////////////////////////////////////////
+// On a miss: was this line bypassed a moment ago?
+///////////////////////////////////////////////////////////////////
+
+void    dbp_check_bypass(Dead_Block *dbp, Addr lineaddr){
+  uns ii = dbp_filter_index(lineaddr);
+  if(dbp->filter_tag[ii] == lineaddr+1){
+    dbp_train(dbp, dbp->filter_sig[ii], FALSE);
+    dbp->filter_tag[ii] = 0;
+    dbp->stat_bypass_wrong++;
+  }
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+void    dbp_print_stats(Dead_Block *dbp, char *header){
+  uns64  pred_dead = dbp->stat_dead_correct + dbp->stat_dead_wrong;
+  uns64  deaths    = dbp->stat_dead_correct + dbp->stat_live_wrong;
+  uns64  fills     = dbp->stat_fills + dbp->stat_bypass;
+
+  printf("\n%s_DBP_ACCURACY_PERC\t\t : %10.3f", header,
+         pred_dead ? 100*(double)(dbp->stat_dead_correct)/(double)(pred_dead) : 0);
+  printf("\n%s_DBP_COVERAGE_PERC\t\t : %10.3f", header,
+         deaths ? 100*(double)(dbp->stat_dead_correct)/(double)(deaths) : 0);
+  printf("\n%s_DBP_BYPASS       \t\t : %10llu", header, dbp->stat_bypass);
+  printf("\n%s_DBP_BYPASS_PERC  \t\t : %10.3f", header,
+         fills ? 100*(double)(dbp->stat_bypass)/(double)(fills) : 0);
+  printf("\n%s_DBP_BYPASS_WRONG \t\t : %10llu", header, dbp->stat_bypass_wrong);
+}
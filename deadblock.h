@@ -0,0 +1,80 @@
+#ifndef DEADBLOCK_H
+#define DEADBLOCK_H
+
+#include "types.h"
+
+#define DBP_SIG_BITS        12
+#define DBP_TABLE_SIZE      (1<<DBP_SIG_BITS)
+#define DBP_CTR_MAX         7
+#define DBP_THRESHOLD       6   // counter at or above: dead
+#define DBP_FILTER_SIZE     4096 // recently bypassed lines
+
+// -L2dbp
+#define DBP_OFF             0
+#define DBP_REPL            1   // evict predicted-dead lines first
+#define DBP_BYPASS          2   // ... and do not fill predicted-dead lines
+
+typedef struct Dead_Block Dead_Block;
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+// Trace-based dead block predictor (Lai et al., ISCA'01, in the
+// PC-signature form of Khan et al., MICRO'10). Every line remembers
+// the signature of the last instruction that touched it, a hash of
+// its PC and core. A table of saturating counters learns, per
+// signature, whether that touch tends to be the line's last: an
+// eviction counts up the victim's signature, a hit counts down the
+// signature of the touch before it.
+//
+// Bypassed fills never get to be hit, so they would never train the
+// counter down again. A small direct-mapped filter remembers recent
+// bypasses; a miss that finds its line there was a wrong bypass and
+// counts that signature down.
+
+struct Dead_Block {
+  uns    mode;
+  uns8   ctr[DBP_TABLE_SIZE];
+  Addr   filter_tag[DBP_FILTER_SIZE];  // lineaddr+1, 0 is empty
+  uns16  filter_sig[DBP_FILTER_SIZE];
+
+  // stats: each prediction made at a line's last touch is checked
+  // when the line is hit again (live) or evicted (dead)
+  uns64  stat_dead_correct;
+  uns64  stat_dead_wrong;     // predicted dead, was hit again
+  uns64  stat_live_wrong;     // predicted live, was evicted
+  uns64  stat_fills;
+  uns64  stat_bypass;
+  uns64  stat_bypass_wrong;   // bypassed line missed again soon
+};
+
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Dead_Block *dbp_new(uns mode);
+void    dbp_print_stats(Dead_Block *dbp, char *header);
+void    dbp_bypassed(Dead_Block *dbp, Addr lineaddr, uns16 sig);
+void    dbp_check_bypass(Dead_Block *dbp, Addr lineaddr);
+
+static inline uns16 dbp_signature(Addr pc, uns core_id){
+  uns64 h = (pc ^ ((uns64)(core_id) << 40)) * 0x9E3779B97F4A7C15ULL;
+  return (uns16)(h >> (64 - DBP_SIG_BITS));
+}
+
+static inline Flag dbp_is_dead(Dead_Block *dbp, uns16 sig){
+  return dbp->ctr[sig] >= DBP_THRESHOLD;
+}
+
+static inline void dbp_train(Dead_Block *dbp, uns16 sig, Flag dead){
+  if(dead){
+    dbp->ctr[sig] += (dbp->ctr[sig] < DBP_CTR_MAX);
+  } else {
+    dbp->ctr[sig] -= (dbp->ctr[sig] > 0);
+  }
+}
+
+
+
+#endif // DEADBLOCK_H
@@ -1,26 +1,37 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "dram.h"
 
-#define ROWBUF_SIZE         1024
-#define DRAM_BANKS          16
-
 //---- Latency for Part B ------
 
 #define DRAM_LATENCY_FIXED  100
 
-//---- Latencies for Part C,D,E --
-
-#define DRAM_T_ACT         45
-#define DRAM_T_CAS         45
-#define DRAM_T_PRE         45
-#define DRAM_T_BUS         10
+//---- Latencies for Part C,D,E come from dramtiming (-dramtiming, -dramcfg) --
 
 
 extern MODE   SIM_MODE;
 extern uns64  CACHE_LINESIZE;
+extern uns64  DRAM_CTRL;
+extern uns64  DRAM_CHANNELS;
+extern uns64  DRAM_RANKS;
+extern uns64  DRAM_BANKS;
+extern uns64  DRAM_ROWBUF_SIZE;
+extern uns64  DRAM_MAPPING;
+extern uns64  DRAM_CH_INTERLEAVE;
+extern uns64  DRAM_PAGE_POLICY;
+extern uns64  DRAM_PAGE_TIMEOUT;
+extern uns64  DRAM_REFRESH;
+extern uns64  DRAM_T_REFI;
+extern uns64  DRAM_T_RFC;
+extern uns64  DRAM_WQ_HIGH;
+extern uns64  DRAM_WQ_LOW;
+extern uns64  DRAM_ENERGY;
+extern uns64  CORE_FREQ_MHZ;
+extern uns64  DRAM_SAMPLE_INTERVAL;
+extern char   DRAM_SAMPLE_FILE[];
 extern uns64 cycle; // You can use this as timestamp for LRU
 
 
@@ -28,19 +39,220 @@ extern uns64 cycle; // You can use this as timestamp for LRU
 ///////////////////////////////////////////////////////////////////
 
 DRAM   *dram_new(){
+  DRAM_Config cfg;
+  dram_default_config(&cfg);
+  return dram_new_config(&cfg);
+}
+
+///////////////////////////////////////////////////////////////////
+// Main memory, as set up by the -dram* options
+///////////////////////////////////////////////////////////////////
+
+void    dram_default_config(DRAM_Config *cfg){
+  memset(cfg, 0, sizeof(DRAM_Config));
+  snprintf(cfg->name, sizeof(cfg->name), "DRAM");
+  cfg->spec          = dramtiming_current();
+  cfg->channels      = DRAM_CHANNELS;
+  cfg->ranks         = DRAM_RANKS;
+  cfg->banks         = DRAM_BANKS;
+  cfg->rowbuf_size   = DRAM_ROWBUF_SIZE;
+  cfg->mapping       = DRAM_MAPPING;
+  cfg->ch_interleave = DRAM_CH_INTERLEAVE;
+  cfg->page_policy   = DRAM_PAGE_POLICY;
+  cfg->page_timeout  = DRAM_PAGE_TIMEOUT;
+  cfg->refresh       = DRAM_REFRESH;
+  cfg->t_refi        = DRAM_T_REFI;
+  cfg->t_rfc         = DRAM_T_RFC;
+  cfg->ctrl          = DRAM_CTRL;
+  cfg->wq_high       = DRAM_WQ_HIGH;
+  cfg->wq_low        = DRAM_WQ_LOW;
+  cfg->sample_interval = DRAM_SAMPLE_INTERVAL;
+  cfg->sample_file     = DRAM_SAMPLE_FILE;
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+DRAM   *dram_new_config(DRAM_Config *cfg){
   DRAM *dram = (DRAM *) calloc (1, sizeof (DRAM));
-  assert(DRAM_BANKS <= MAX_DRAM_BANKS);
+  dram->cfg               = *cfg;
+  dram->num_channels      = cfg->channels;
+  dram->banks_per_channel = cfg->ranks*cfg->banks;
+  dram->page_policy       = cfg->page_policy;
+  dram->detail_stats      = cfg->ctrl || (cfg->channels > 1) || (cfg->ranks > 1) ||
+                            (cfg->mapping != DRAM_MAP_ROW_BANK_COL) ||
+                            (cfg->page_policy != PAGE_POLICY_OPEN) ||
+                            (cfg->refresh != DRAM_REFRESH_OFF) || !dramtiming_is_legacy(cfg->spec);
+
+  if((cfg->channels == 0) || (cfg->channels > MAX_DRAM_CHANNELS) ||
+     (cfg->ranks == 0) || (cfg->banks == 0) ||
+     (cfg->channels*dram->banks_per_channel > MAX_DRAM_BANKS)){
+    printf("%s organization %llu channels x %llu ranks x %llu banks is not supported\n",
+           cfg->name, cfg->channels, cfg->ranks, cfg->banks);
+    exit(-1);
+  }
+  if((cfg->rowbuf_size < CACHE_LINESIZE) || (cfg->rowbuf_size % CACHE_LINESIZE) ||
+     (cfg->ch_interleave < CACHE_LINESIZE) || (cfg->ch_interleave % CACHE_LINESIZE)){
+    printf("%s row size and channel interleave must be multiples of the line size\n", cfg->name);
+    exit(-1);
+  }
+  if((cfg->mapping == DRAM_MAP_XOR_BANK) && (cfg->banks & (cfg->banks-1))){
+    printf("XOR bank mapping needs a power-of-two number of banks\n");
+    exit(-1);
+  }
+  if(cfg->mapping > DRAM_MAP_XOR_BANK){
+    printf("Unknown DRAM address mapping %llu\n", cfg->mapping);
+    exit(-1);
+  }
+  if(cfg->page_policy > PAGE_POLICY_ADAPTIVE){
+    printf("Unknown DRAM page policy %llu\n", cfg->page_policy);
+    exit(-1);
+  }
+  if((cfg->wq_low >= cfg->wq_high) || (cfg->wq_high > DRAMCTRL_WQ_SIZE)){
+    printf("DRAM write queue watermarks need low < high <= %u\n", DRAMCTRL_WQ_SIZE);
+    exit(-1);
+  }
+  if(cfg->refresh > DRAM_REFRESH_PERBANK){
+    printf("Unknown DRAM refresh mode %llu\n", cfg->refresh);
+    exit(-1);
+  }
+
+  // -dramtrefi/-dramtrfc (in cycles) override the timing preset
+  dram->refresh.mode           = cfg->refresh;
+  dram->refresh.num_ranks      = cfg->ranks;
+  dram->refresh.banks_per_rank = cfg->banks;
+  dramtiming_get(cfg->spec, &dram->timing, &dram->refresh);
+  dramtiming_get_energy(cfg->spec, &dram->energy);
+  if(cfg->t_refi){
+    dram->refresh.t_refi = cfg->t_refi;
+  }
+  if(cfg->t_rfc){
+    dram->refresh.t_rfc  = cfg->t_rfc;
+  }
+
+  if(cfg->ctrl && (SIM_MODE!=SIM_MODE_B)){
+    for(uns ii=0; ii<dram->num_channels; ii++){
+      dram->ctrl[ii] = dramctrl_new(&dram->timing, &dram->refresh, dram->banks_per_channel,
+                                    cfg->page_policy, cfg->page_timeout,
+                                    cfg->wq_high, cfg->wq_low);
+    }
+  }
+
+  if(cfg->sample_interval){
+    dram->sample_fp = fopen(cfg->sample_file, "w");
+    if(dram->sample_fp == NULL){
+      printf("Could not open DRAM sample file %s\n", cfg->sample_file);
+      exit(-1);
+    }
+    // rows are written in big chunks, off the access path
+    setvbuf(dram->sample_fp, NULL, _IOFBF, 1<<20);
+    fprintf(dram->sample_fp, "start_cycle,end_cycle,reads,writes,read_gbps,write_gbps,"
+            "read_delay_avg,read_delay_p50,read_delay_p90,read_delay_p99,read_delay_max,row_hit_perc\n");
+  }
   return dram;
 }
 
+///////////////////////////////////////////////////////////////////
+// Channels take ch_interleave bytes in turn; the line address
+// within the channel is then split per the mapping. The XOR scheme
+// (Zhang et al., MICRO'00) keeps the lines of a row together but
+// permutes banks by the low row bits, so rows that conflict in one
+// bank under row:bank:col are spread over all of them.
+///////////////////////////////////////////////////////////////////
+
+void    dram_map(DRAM *dram, Addr lineaddr, DRAM_Addr *da){
+  DRAM_Config *cfg    = &dram->cfg;
+  uns64 lines_per_row = cfg->rowbuf_size/CACHE_LINESIZE;
+  uns64 ch_lines      = cfg->ch_interleave/CACHE_LINESIZE;
+  uns64 bank_in_rank, rank;
+
+  da->channel = (lineaddr/ch_lines) % dram->num_channels;
+  lineaddr    = (lineaddr/(ch_lines*dram->num_channels))*ch_lines + lineaddr%ch_lines;
+
+  if(cfg->mapping == DRAM_MAP_ROW_COL_BANK){
+    bank_in_rank = lineaddr % cfg->banks;
+    rank         = (lineaddr/cfg->banks) % cfg->ranks;
+    da->row      = lineaddr/(dram->banks_per_channel*lines_per_row);
+  } else {
+    uns64 row_addr = lineaddr/lines_per_row;
+    bank_in_rank = row_addr % cfg->banks;
+    rank         = (row_addr/cfg->banks) % cfg->ranks;
+    da->row      = row_addr/dram->banks_per_channel;
+    if(cfg->mapping == DRAM_MAP_XOR_BANK){
+      bank_in_rank ^= da->row & (cfg->banks-1);
+    }
+  }
+
+  da->bank = rank*cfg->banks + bank_in_rank;
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+static void dram_row_stats(DRAM *dram, uns ch, uns64 *row){
+  for(uns kk=0; kk<DRAM_ROW_OUTCOMES; kk++){
+    row[kk] += dram->ctrl[ch] ? dram->ctrl[ch]->stat_row[kk] : dram->stat_ch_row[ch][kk];
+  }
+}
+
+static double dram_row_hit_rate(uns64 *row){
+  uns64 total = row[DRAM_ROW_HIT] + row[DRAM_ROW_CONFLICT] + row[DRAM_ROW_EMPTY];
+  return total ? (double)(row[DRAM_ROW_HIT])/(double)(total) : 0;
+}
+
+///////////////////////////////////////////////////////////////////
+// Energy from the event counts: ACT/PRE pairs are the row misses,
+// bursts are the accesses, and every rank refreshes once per tREFI
+// and burns standby power for the whole run. Refresh energy is
+// counted even when -dramrefresh does not model its latency, since
+// the device refreshes either way.
+///////////////////////////////////////////////////////////////////
+
+static void dram_print_energy(DRAM *dram, char *header, uns64 *row){
+  DRAM_Energy *e = &dram->energy;
+  double ranks   = dram->num_channels*dram->refresh.num_ranks;
+  double seconds = (double)(cycle)/((double)(CORE_FREQ_MHZ)*1e6);
+  double refs    = ranks*(double)(cycle)/(double)(dram->refresh.t_refi);
+
+  // in uJ
+  double act_energy = 1e-6*(double)(row[DRAM_ROW_CONFLICT] + row[DRAM_ROW_EMPTY])*(double)(e->e_act);
+  double rd_energy  = 1e-6*(double)(dram->stat_read_access + dram->stat_bg_read_access)*(double)(e->e_rd);
+  double wr_energy  = 1e-6*(double)(dram->stat_write_access)*(double)(e->e_wr);
+  double ref_energy = 1e-6*refs*(double)(e->e_ref);
+  double bg_energy  = 1e3*ranks*(double)(e->p_bg)*seconds;
+  double total      = act_energy + rd_energy + wr_energy + ref_energy + bg_energy;
+  uns64  accesses   = dram->stat_read_access + dram->stat_bg_read_access + dram->stat_write_access;
+
+  printf("\n%s_ENERGY_ACT_UJ   \t : %10.3f", header, act_energy);
+  printf("\n%s_ENERGY_RD_UJ    \t : %10.3f", header, rd_energy);
+  printf("\n%s_ENERGY_WR_UJ    \t : %10.3f", header, wr_energy);
+  printf("\n%s_ENERGY_REF_UJ   \t : %10.3f", header, ref_energy);
+  printf("\n%s_ENERGY_BG_UJ    \t : %10.3f", header, bg_energy);
+  printf("\n%s_ENERGY_UJ       \t : %10.3f", header, total);
+  printf("\n%s_ENERGY_PER_ACCESS_NJ\t : %10.3f", header, accesses ? 1e3*total/(double)(accesses) : 0);
+  printf("\n%s_AVG_POWER_MW    \t : %10.3f", header, seconds ? 1e-3*total/seconds : 0);
+}
+
 ///////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////
 
 void    dram_print_stats(DRAM *dram){
   double rddelay_avg=0;
   double wrdelay_avg=0;
+  uns64  wr_done=0, wr_delay=0;
+  uns64  row[DRAM_ROW_OUTCOMES] = {0};
+  uns64  ref_delay=dram->stat_refresh_delay, ref_closes=dram->stat_refresh_closes;
   char header[256];
-  sprintf(header, "DRAM");
+  sprintf(header, "%s", dram->cfg.name);
+
+  // the run is over, write out the last (partial) interval
+  if(dram->sample_fp){
+    if(cycle > dram->sample_start){
+      dram_sample(dram, cycle);
+    }
+    fclose(dram->sample_fp);
+    dram->sample_fp = NULL;
+  }
   
   if(dram->stat_read_access){
     rddelay_avg=(double)(dram->stat_read_delay)/(double)(dram->stat_read_access);
@@ -50,41 +262,149 @@ void    dram_print_stats(DRAM *dram){
     wrdelay_avg=(double)(dram->stat_write_delay)/(double)(dram->stat_write_access);
   }
 
+  // the controller posts writes, their latency is known once they are done
+  for(uns ii=0; ii<dram->num_channels; ii++){
+    if(dram->ctrl[ii]){
+      wr_done  += dram->ctrl[ii]->stat_write_done;
+      wr_delay += dram->ctrl[ii]->stat_write_delay;
+      ref_delay  += dram->ctrl[ii]->stat_refresh_delay;
+      ref_closes += dram->ctrl[ii]->stat_refresh_closes;
+    }
+    dram_row_stats(dram, ii, row);
+  }
+  if(wr_done){
+    wrdelay_avg=(double)(wr_delay)/(double)(wr_done);
+  }
+
   printf("\n%s_READ_ACCESS\t\t : %10llu", header, dram->stat_read_access);
   printf("\n%s_WRITE_ACCESS\t\t : %10llu", header, dram->stat_write_access);
   printf("\n%s_READ_DELAY_AVG\t\t : %10.3f", header, rddelay_avg);
   printf("\n%s_WRITE_DELAY_AVG\t\t : %10.3f", header, wrdelay_avg);
+  if(dram->stat_bg_read_access){
+    printf("\n%s_BG_READ_ACCESS\t\t : %10llu", header, dram->stat_bg_read_access);
+  }
+
+  if(dram->detail_stats){
+    dramtiming_print(dram->cfg.spec, &dram->timing, header);
+    printf("\n%s_PAGE_POLICY\t\t : %10u", header, dram->page_policy);
+    printf("\n%s_ROW_HITS\t\t : %10llu", header, row[DRAM_ROW_HIT]);
+    printf("\n%s_ROW_CONFLICTS\t\t : %10llu", header, row[DRAM_ROW_CONFLICT]);
+    printf("\n%s_ROW_EMPTIES\t\t : %10llu", header, row[DRAM_ROW_EMPTY]);
+    printf("\n%s_ROW_HIT_PERC\t\t : %10.3f", header, 100*dram_row_hit_rate(row));
+  }
+
+  if(dram->detail_stats || DRAM_ENERGY){
+    dram_print_energy(dram, header, row);
+  }
+
+  if(dram->refresh.mode != DRAM_REFRESH_OFF){
+    double ref_share = dram->stat_read_delay ? (double)(ref_delay)/(double)(dram->stat_read_delay) : 0;
+    printf("\n%s_REFRESH_ROW_CLOSES\t : %10llu", header, ref_closes);
+    printf("\n%s_REFRESH_DELAY_PERC\t : %10.3f", header, 100*ref_share);
+  }
 
+  if(dram->num_channels == 1){
+    if(dram->ctrl[0]){
+      dramctrl_print_stats(dram->ctrl[0], header);
+    }
+    return;
+  }
 
+  printf("\n");
+  for(uns ii=0; ii<dram->num_channels; ii++){
+    double ch_rddelay_avg=0;
+    uns64  ch_row[DRAM_ROW_OUTCOMES] = {0};
+
+    sprintf(header, "%s_CH%u", dram->cfg.name, ii);
+    if(dram->stat_ch_read_access[ii]){
+      ch_rddelay_avg=(double)(dram->stat_ch_read_delay[ii])/(double)(dram->stat_ch_read_access[ii]);
+    }
+    dram_row_stats(dram, ii, ch_row);
+
+    printf("\n%s_READ_ACCESS\t\t : %10llu", header, dram->stat_ch_read_access[ii]);
+    printf("\n%s_WRITE_ACCESS\t\t : %10llu", header, dram->stat_ch_write_access[ii]);
+    printf("\n%s_READ_DELAY_AVG\t\t : %10.3f", header, ch_rddelay_avg);
+    printf("\n%s_ROW_CONFLICTS\t\t : %10llu", header, ch_row[DRAM_ROW_CONFLICT]);
+    printf("\n%s_ROW_HIT_PERC\t\t : %10.3f", header, 100*dram_row_hit_rate(ch_row));
+    if(dram->ctrl[ii]){
+      dramctrl_print_stats(dram->ctrl[ii], header);
+    } else {
+      printf("\n");
+    }
+  }
 }
 
 ///////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////
 
-uns64   dram_access(DRAM *dram,Addr lineaddr, Flag is_dram_write) {
+static uns64 dram_access_timing(DRAM *dram, Addr lineaddr, Flag is_dram_write, DRAM_Addr *da){
   uns64 delay=DRAM_LATENCY_FIXED;
 
-  if(SIM_MODE!=SIM_MODE_B){
-    delay = dram_access_mode_CDE(dram, lineaddr, is_dram_write);
+  while(dram->sample_fp && (cycle >= dram->sample_start + dram->cfg.sample_interval)){
+    dram_sample(dram, dram->sample_start + dram->cfg.sample_interval);
   }
 
+  dram_map(dram, lineaddr, da);
+
+  if(dram->ctrl[da->channel]){
+    delay = dram_access_ctrl(dram, da, is_dram_write);
+  } else if(SIM_MODE!=SIM_MODE_B){
+    delay = dram_access_mode_CDE(dram, da, is_dram_write);
+  }
+  return delay;
+}
+
+uns64   dram_access(DRAM *dram,Addr lineaddr, Flag is_dram_write) {
+  DRAM_Addr da;
+  uns64 delay = dram_access_timing(dram, lineaddr, is_dram_write, &da);
+
   // Update stats
   if(is_dram_write){
     dram->stat_write_access++;
     dram->stat_write_delay+=delay;
+    dram->stat_ch_write_access[da.channel]++;
   }else{
     dram->stat_read_access++;
     dram->stat_read_delay+=delay;
+    dram->stat_ch_read_access[da.channel]++;
+    dram->stat_ch_read_delay[da.channel]+=delay;
+  }
+
+  if(dram->sample_fp){
+    if(is_dram_write){
+      dram->sample_write_access++;
+    } else {
+      dram->sample_read_access++;
+      hist_add(&dram->sample_read_delay, delay);
+    }
   }
   
   return delay;
 }
 
+///////////////////////////////////////////////////////////////////
+// Read nothing waits for, e.g. the rest of a DRAM cache page behind
+// the demand line, or a dirty victim on its way out. It occupies
+// banks and bus like any read, but is kept out of the read access
+// and delay stats.
+///////////////////////////////////////////////////////////////////
+
+uns64   dram_background_read(DRAM *dram, Addr lineaddr){
+  DRAM_Addr da;
+  uns64 delay = dram_access_timing(dram, lineaddr, FALSE, &da);
+
+  dram->stat_bg_read_access++;
+  if(dram->sample_fp){
+    dram->sample_read_access++; // bandwidth only, not latency
+  }
+  return delay;
+}
+
 ///////////////////////////////////////////////////////////////////
 // Modify the function below only for Parts C/D/E
 ///////////////////////////////////////////////////////////////////
 
-uns64   dram_access_mode_CDE(DRAM *dram,Addr lineaddr, Flag is_dram_write){
+uns64   dram_access_mode_CDE(DRAM *dram, DRAM_Addr *da, Flag is_dram_write){
   uns64 delay=DRAM_LATENCY_FIXED;
 
     // Assume a mapping with consecutive lines in the same row
@@ -101,34 +421,110 @@ uns64   dram_access_mode_CDE(DRAM *dram,Addr lineaddr, Flag is_dram_write){
     // intermediate addr = lineaddr/(line-offset)
     // num_bank = intermediate addr%16
     // num_dram_row = intermediate addr/16
-  uns64 line_offset = ROWBUF_SIZE/CACHE_LINESIZE;
-  uns64 inter_addr = lineaddr/line_offset; // [row-id + bank_num] => inter_addr
-  uns64 num_bank = inter_addr % DRAM_BANKS;
-  uns64 num_dram_row = inter_addr/DRAM_BANKS;
+    // (dram_map generalizes this to channels, ranks and other mappings)
+  uns64 num_bank = da->channel*dram->banks_per_channel + da->bank;
+  uns64 num_dram_row = da->row;
+
+  assert (num_bank < MAX_DRAM_BANKS);
+  Rowbuf_Entry *rb = &dram->perbank_row_buf[num_bank];
+  DRAM_Timing  *tm = &dram->timing;
+  uns64 ref_delay = 0;
+
+  // A refresh precharges the bank, and an access that arrives during
+  // one waits for it to finish
+  if(dram->refresh.mode != DRAM_REFRESH_OFF){
+    uns64 ref_start;
+    ref_delay = dramctrl_refresh_ready(&dram->refresh, da->bank, cycle, &ref_start) - cycle;
+    if(rb->valid && (rb->last_access < ref_start)){
+      rb->valid = false;
+      dram->stat_refresh_closes++;
+    }
+    if(!is_dram_write){
+      dram->stat_refresh_delay += ref_delay;
+    }
+  }
+
+  // Other page policies close the row off the critical path once the
+  // previous access is done, so the precharge is not charged here
+  if(rb->valid && (dram->page_policy != PAGE_POLICY_OPEN)){
+    if((dram->page_policy == PAGE_POLICY_CLOSED) ||
+       ((dram->page_policy == PAGE_POLICY_TIMEOUT) && (cycle - rb->last_access >= dram->cfg.page_timeout)) ||
+       ((dram->page_policy == PAGE_POLICY_ADAPTIVE) && dram_page_pred_close(rb->close_ctr))){
+      rb->valid = false;
+    }
+  }
+  if(rb->seen){
+    rb->close_ctr = dram_page_pred_update(rb->close_ctr, rb->rowid == num_dram_row);
+  }
+  rb->seen = true;
+  rb->last_access = cycle;
 
-  assert (num_bank < DRAM_BANKS);
   // What if row buffer is empty!.. there is a valid bit for that..
-  if (dram->perbank_row_buf[num_bank].valid == false) {
-    delay = DRAM_T_ACT + DRAM_T_CAS + DRAM_T_BUS;
+  if (rb->valid == false) {
+    delay = tm->t_rcd + tm->t_cas + tm->t_burst;
     // Now put valid as true
-    dram->perbank_row_buf[num_bank].valid = true;
+    rb->valid = true;
     // Initialize the row as well!!
-    dram->perbank_row_buf[num_bank].rowid = num_dram_row;
+    rb->rowid = num_dram_row;
+    dram->stat_ch_row[da->channel][DRAM_ROW_EMPTY]++;
   }
   // If hit; calculate delay
-  else if((dram->perbank_row_buf[num_bank].rowid == num_dram_row) && 
-      dram->perbank_row_buf[num_bank].valid) {
-    delay = DRAM_T_CAS + DRAM_T_BUS;
+  else if(rb->rowid == num_dram_row) {
+    delay = tm->t_cas + tm->t_burst;
+    dram->stat_ch_row[da->channel][DRAM_ROW_HIT]++;
   }
   // if miss; calculate delay
-  else if ((dram->perbank_row_buf[num_bank].rowid != num_dram_row) && 
-      dram->perbank_row_buf[num_bank].valid) {  
+  else {
     // This is a case of miss.. so bring the required row in the row-buffer
-    dram->perbank_row_buf[num_bank].rowid = num_dram_row;
+    rb->rowid = num_dram_row;
     // calculate delay
-    delay = DRAM_T_ACT + DRAM_T_PRE + DRAM_T_CAS + DRAM_T_BUS;
+    delay = tm->t_rcd + tm->t_rp + tm->t_cas + tm->t_burst;
+    dram->stat_ch_row[da->channel][DRAM_ROW_CONFLICT]++;
   }
-  return delay;
+  return delay + ref_delay;
+}
+
+///////////////////////////////////////////////////////////////////
+// Same address mapping as above, timed by the channel's controller
+///////////////////////////////////////////////////////////////////
+
+uns64   dram_access_ctrl(DRAM *dram, DRAM_Addr *da, Flag is_dram_write){
+  return dramctrl_access(dram->ctrl[da->channel], da->bank, da->row, is_dram_write, cycle);
 }
 
+///////////////////////////////////////////////////////////////////
+// Close the interval [sample_start, end_cycle) with one CSV row.
+// Accesses count in the interval they arrive in. Row outcomes are
+// the change in the run-wide counters, so the controller's posted
+// writes count when they are issued.
+///////////////////////////////////////////////////////////////////
+
+void    dram_sample(DRAM *dram, uns64 end_cycle){
+  uns64  row[DRAM_ROW_OUTCOMES] = {0};
+  uns64  delta[DRAM_ROW_OUTCOMES];
+  Hist  *h = &dram->sample_read_delay;
+  double seconds = (double)(end_cycle - dram->sample_start)/((double)(CORE_FREQ_MHZ)*1e6);
+  double rd_gbps = 0, wr_gbps = 0;
 
+  for(uns ii=0; ii<dram->num_channels; ii++){
+    dram_row_stats(dram, ii, row);
+  }
+  for(uns kk=0; kk<DRAM_ROW_OUTCOMES; kk++){
+    delta[kk] = row[kk] - dram->sample_row[kk];
+    dram->sample_row[kk] = row[kk];
+  }
+  if(seconds > 0){
+    rd_gbps = 1e-9*(double)(dram->sample_read_access*CACHE_LINESIZE)/seconds;
+    wr_gbps = 1e-9*(double)(dram->sample_write_access*CACHE_LINESIZE)/seconds;
+  }
+
+  fprintf(dram->sample_fp, "%llu,%llu,%llu,%llu,%.3f,%.3f,%.3f,%llu,%llu,%llu,%llu,%.3f\n",
+          dram->sample_start, end_cycle, dram->sample_read_access, dram->sample_write_access,
+          rd_gbps, wr_gbps, hist_mean(h), hist_percentile(h, 50), hist_percentile(h, 90),
+          hist_percentile(h, 99), h->max, 100*dram_row_hit_rate(delta));
+
+  dram->sample_start        = end_cycle;
+  dram->sample_read_access  = 0;
+  dram->sample_write_access = 0;
+  hist_reset(h);
+}
@@ -6,8 +6,17 @@
 #include <stdlib.h>
 
 #include "types.h"
+#include "dramctrl.h"
+#include "dramtiming.h"
+#include "hist.h"
 
-#define MAX_DRAM_BANKS          256
+#define MAX_DRAM_BANKS          256  // over all channels and ranks
+#define MAX_DRAM_CHANNELS       8
+
+// Address mapping schemes (-drammap), from the channel-local line address
+#define DRAM_MAP_ROW_BANK_COL   0  // a row's lines are consecutive, rows spread over banks
+#define DRAM_MAP_ROW_COL_BANK   1  // consecutive lines go to consecutive banks
+#define DRAM_MAP_XOR_BANK       2  // row:bank:col, bank XORed with the low row bits
 
 
 
@@ -15,23 +24,89 @@
 //////////////////////////////////////////////////////////////////
 
 typedef struct DRAM   DRAM;
+typedef struct DRAM_Config DRAM_Config;
 typedef struct Rowbuf_Entry Rowbuf_Entry;
+typedef struct DRAM_Addr DRAM_Addr;
+
+
+// Everything that makes one DRAM instance. Main memory takes its
+// configuration from the -dram* options (dram_default_config), other
+// DRAM devices such as the DRAM cache fill in their own.
+struct DRAM_Config {
+  char   name[32];                // stats header
+  const DRAM_Timing_Spec *spec;
+  uns64  channels;
+  uns64  ranks;
+  uns64  banks;                   // per rank
+  uns64  rowbuf_size;             // bytes
+  uns64  mapping;
+  uns64  ch_interleave;           // bytes
+  uns64  page_policy;
+  uns64  page_timeout;
+  uns64  refresh;
+  uns64  t_refi;                  // cycles, 0 takes it from spec
+  uns64  t_rfc;                   // likewise
+  uns64  ctrl;                    // queued controller instead of closed-form
+  uns64  wq_high;
+  uns64  wq_low;
+  uns64  sample_interval;         // cycles between time-series samples, 0: none
+  const char *sample_file;
+};
 
 
 struct Rowbuf_Entry {
   Flag valid; // 0 means the rowbuffer entry is invalid
-  uns64 rowid; // If the entry is valid, which row?
+  uns64 rowid; // If the entry is valid, which row? (kept after a close)
+  Flag  seen;  // rowid has been set at least once
+  uns64 last_access; // for the timeout page policy
+  uns   close_ctr;   // adaptive page predictor
+};
+
+
+// Where a line lives. Banks are numbered within their channel,
+// rank by rank: bank = rank*DRAM_BANKS + bank in rank.
+struct DRAM_Addr {
+  uns   channel;
+  uns   bank;
+  uns64 row;
 };
 
 
 struct DRAM {
-  Rowbuf_Entry perbank_row_buf[MAX_DRAM_BANKS];
+  DRAM_Config  cfg;
+  uns          num_channels;
+  uns          banks_per_channel; // ranks x banks per rank
+  uns          page_policy;
+  DRAM_Timing  timing;            // in core cycles
+  DRAM_Energy  energy;
+  DRAM_Refresh refresh;           // same schedule in every channel
+  Flag         detail_stats;      // print row stats/channels (non-legacy organization)
+
+  Rowbuf_Entry perbank_row_buf[MAX_DRAM_BANKS]; // [channel*banks_per_channel + bank]
+  DRAM_Ctrl   *ctrl[MAX_DRAM_CHANNELS]; // one queued controller per channel (-dramctrl 1), else closed-form
   
    // stats 
   uns64 stat_read_access;
   uns64 stat_write_access;
   uns64 stat_read_delay;
   uns64 stat_write_delay;
+  uns64 stat_bg_read_access;    // dram_background_read(), not in the above
+
+  uns64 stat_ch_read_access[MAX_DRAM_CHANNELS];
+  uns64 stat_ch_write_access[MAX_DRAM_CHANNELS];
+  uns64 stat_ch_read_delay[MAX_DRAM_CHANNELS];
+  uns64 stat_ch_row[MAX_DRAM_CHANNELS][DRAM_ROW_OUTCOMES]; // closed-form model only,
+                                                          // the controller counts its own
+  uns64 stat_refresh_delay;   // likewise: read cycles spent waiting for a refresh
+  uns64 stat_refresh_closes;
+
+  // time series, one CSV row per sample_interval cycles
+  FILE  *sample_fp;
+  uns64  sample_start;        // cycle the current interval began
+  uns64  sample_read_access;
+  uns64  sample_write_access;
+  uns64  sample_row[DRAM_ROW_OUTCOMES]; // row stats when the interval began
+  Hist   sample_read_delay;
 };
 
 
@@ -40,9 +115,15 @@ struct DRAM {
 //////////////////////////////////////////////////////////////////
 
 DRAM   *dram_new();
+void    dram_default_config(DRAM_Config *cfg);
+DRAM   *dram_new_config(DRAM_Config *cfg);
 void    dram_print_stats(DRAM *dram);
 uns64   dram_access(DRAM *dram,Addr lineaddr, Flag is_dram_write);
-uns64   dram_access_mode_CDE(DRAM *dram,Addr lineaddr, Flag is_dram_write);
+uns64   dram_background_read(DRAM *dram, Addr lineaddr);
+void    dram_map(DRAM *dram, Addr lineaddr, DRAM_Addr *da);
+uns64   dram_access_mode_CDE(DRAM *dram, DRAM_Addr *da, Flag is_dram_write);
+uns64   dram_access_ctrl(DRAM *dram, DRAM_Addr *da, Flag is_dram_write);
+void    dram_sample(DRAM *dram, uns64 end_cycle);
 
 
 
@@ -0,0 +1,346 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dramctrl.h"
+
+extern uns64  cycle;
+
+static inline uns64 dramctrl_max(uns64 a, uns64 b){
+  return (a > b) ? a : b;
+}
+
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+DRAM_Ctrl *dramctrl_new(DRAM_Timing *timing, DRAM_Refresh *refresh, uns num_banks,
+                        uns page_policy, uns64 page_timeout, uns wq_high, uns wq_low){
+  DRAM_Ctrl *ctrl = (DRAM_Ctrl *) calloc (1, sizeof (DRAM_Ctrl));
+  assert(num_banks <= DRAMCTRL_MAX_BANKS);
+  assert(page_policy <= PAGE_POLICY_ADAPTIVE);
+  assert((wq_low < wq_high) && (wq_high <= DRAMCTRL_WQ_SIZE));
+  ctrl->wq_high      = wq_high;
+  ctrl->wq_low       = wq_low;
+  ctrl->timing       = *timing;
+  ctrl->refresh      = *refresh;
+  ctrl->num_banks    = num_banks;
+  ctrl->page_policy  = page_policy;
+  ctrl->page_timeout = page_timeout;
+  return ctrl;
+}
+
+///////////////////////////////////////////////////////////////////
+// Earliest cycle at or after t that bank is not being refreshed.
+// *ref_start is the start of its last refresh at or before t (0 if
+// none yet), so rows used before then are known to be closed.
+///////////////////////////////////////////////////////////////////
+
+uns64      dramctrl_refresh_ready(DRAM_Refresh *refresh, uns bank, uns64 t, uns64 *ref_start){
+  uns slots, slot;
+
+  *ref_start = 0;
+  if(refresh->mode == DRAM_REFRESH_OFF){
+    return t;
+  }
+
+  if(refresh->mode == DRAM_REFRESH_ALLBANK){
+    slots = refresh->num_ranks;
+    slot  = bank/refresh->banks_per_rank;
+  } else {
+    slots = refresh->num_ranks*refresh->banks_per_rank;
+    slot  = bank;
+  }
+
+  uns64 offset = refresh->t_refi*slot/slots;
+  if(t < offset){
+    return t;
+  }
+
+  *ref_start = offset + ((t - offset)/refresh->t_refi)*refresh->t_refi;
+  return dramctrl_max(t, *ref_start + refresh->t_rfc);
+}
+
+///////////////////////////////////////////////////////////////////
+// Precharge the open row of b at cycle pre (no earlier than tRAS
+// after its ACT), leaving open_row behind for the predictor
+///////////////////////////////////////////////////////////////////
+
+static void dramctrl_precharge(DRAM_Ctrl *ctrl, DRAM_Bank *b, uns64 pre){
+  pre = dramctrl_max(pre, b->act_cycle + ctrl->timing.t_ras);
+  b->act_ready = pre + ctrl->timing.t_rp;
+  b->row_valid = FALSE;
+}
+
+///////////////////////////////////////////////////////////////////
+// Book the first free burst slot on the data bus at or after want.
+// A read burst must start tWTR+tCAS after the end of a write burst
+// before it, and a write must leave that much room before a read
+// after it. Bursts that can no longer be in anyone's way at the
+// previous arrival are dropped first.
+///////////////////////////////////////////////////////////////////
+
+static uns64 dramctrl_bus_book(DRAM_Ctrl *ctrl, uns64 want, Flag is_write){
+  uns64 burst = ctrl->timing.t_burst;
+  uns64 wtr   = ctrl->timing.t_wtr + ctrl->timing.t_cas;
+  uns   old = 0;
+
+  while((old < ctrl->bus_slots) && (ctrl->bus_slot[old].start + burst + wtr <= ctrl->last_arrival)){
+    old++;
+  }
+  if((old == 0) && (ctrl->bus_slots == DRAMCTRL_BUS_SLOTS)){
+    old = 1; // too far ahead to track, forget the oldest
+  }
+  for(uns ii=old; ii<ctrl->bus_slots; ii++){
+    ctrl->bus_slot[ii-old] = ctrl->bus_slot[ii];
+  }
+  ctrl->bus_slots -= old;
+
+  uns ii;
+  for(ii=0; ii<ctrl->bus_slots; ii++){
+    DRAM_Burst *slot = &ctrl->bus_slot[ii];
+    uns64 gap_before = (slot->is_write && !is_write) ? wtr : 0;
+    uns64 gap_after  = (!slot->is_write && is_write) ? wtr : 0;
+    if(slot->start + burst + gap_before <= want){
+      continue;          // over before we start
+    }
+    if(slot->start >= want + burst + gap_after){
+      break;             // we fit in the gap before it
+    }
+    want = slot->start + burst + gap_before; // overlap, try right after it
+  }
+
+  for(uns kk=ctrl->bus_slots; kk>ii; kk--){
+    ctrl->bus_slot[kk] = ctrl->bus_slot[kk-1];
+  }
+  ctrl->bus_slot[ii].start    = want;
+  ctrl->bus_slot[ii].is_write = is_write;
+  ctrl->bus_slots++;
+
+  ctrl->stat_bus_busy += burst;
+  if(!is_write && (ii > 0) && ctrl->bus_slot[ii-1].is_write){
+    ctrl->stat_wtr_turnarounds++;
+  }
+  return want;
+}
+
+///////////////////////////////////////////////////////////////////
+// End of the last burst booked on the data bus
+///////////////////////////////////////////////////////////////////
+
+static uns64 dramctrl_bus_end(DRAM_Ctrl *ctrl){
+  if(ctrl->bus_slots == 0){
+    return 0;
+  }
+  return ctrl->bus_slot[ctrl->bus_slots-1].start + ctrl->timing.t_burst;
+}
+
+///////////////////////////////////////////////////////////////////
+// Issue an access to (bank,row) no earlier than t: PRE if another
+// row is open, ACT if the bank is closed, then CAS, moved later if
+// need be so that its burst lands in a free bus slot. Returns the
+// cycle the data transfer ends; *first is the first command's cycle.
+///////////////////////////////////////////////////////////////////
+
+static uns64 dramctrl_issue(DRAM_Ctrl *ctrl, uns bank, uns64 row, Flag is_write, uns64 t, uns64 *first){
+  DRAM_Timing *tm = &ctrl->timing;
+  DRAM_Bank   *b  = &ctrl->bank[bank];
+  uns64 cas;
+
+  if(ctrl->refresh.mode != DRAM_REFRESH_OFF){
+    uns64 ref_start;
+    uns64 ready = dramctrl_refresh_ready(&ctrl->refresh, bank, t, &ref_start);
+    if(b->row_valid && (b->busy_until <= ref_start)){
+      b->row_valid = FALSE;
+      b->act_ready = dramctrl_max(b->act_ready, ref_start + ctrl->refresh.t_rfc);
+      ctrl->stat_refresh_closes++;
+    }
+    if(!is_write){
+      ctrl->stat_refresh_delay += ready - t;
+    }
+    t = ready;
+  }
+
+  // a timed-out row was closed as soon as it had been idle long enough
+  if((ctrl->page_policy == PAGE_POLICY_TIMEOUT) && b->row_valid &&
+     (dramctrl_max(b->pre_ready + ctrl->page_timeout, b->act_cycle + tm->t_ras) <= t)){
+    dramctrl_precharge(ctrl, b, b->pre_ready + ctrl->page_timeout);
+  }
+
+  Flag row_hit = b->row_valid && (b->open_row == row);
+  ctrl->stat_row[row_hit ? DRAM_ROW_HIT : (b->row_valid ? DRAM_ROW_CONFLICT : DRAM_ROW_EMPTY)]++;
+  if(b->row_seen){
+    b->close_ctr = dram_page_pred_update(b->close_ctr, b->open_row == row);
+  }
+
+  if(row_hit){
+    cas = dramctrl_max(t, b->cas_ready);
+  } else {
+    uns64 act;
+    if(b->row_valid){ // close the open row, no earlier than tRAS after its ACT
+      uns64 pre = dramctrl_max(dramctrl_max(t, b->pre_ready), b->act_cycle + tm->t_ras);
+      act    = pre + tm->t_rp;
+      *first = pre;
+    } else {
+      act    = dramctrl_max(t, b->act_ready);
+      *first = act;
+    }
+    b->row_valid = TRUE;
+    b->row_seen  = TRUE;
+    b->open_row  = row;
+    b->act_cycle = act;
+    cas = act + tm->t_rcd;
+  }
+
+  uns64 data = dramctrl_bus_book(ctrl, cas + tm->t_cas, is_write);
+  uns64 done = data + tm->t_burst;
+  cas = data - tm->t_cas;
+  if(row_hit){
+    *first = cas;
+  }
+
+  b->cas_ready  = cas + tm->t_burst;
+  b->pre_ready  = is_write ? done : cas + tm->t_burst;
+  b->busy_until = dramctrl_max(b->busy_until, done);
+
+  // auto-precharge right after the column access
+  if((ctrl->page_policy == PAGE_POLICY_CLOSED) ||
+     ((ctrl->page_policy == PAGE_POLICY_ADAPTIVE) && dram_page_pred_close(b->close_ctr))){
+    dramctrl_precharge(ctrl, b, b->pre_ready);
+  }
+  return done;
+}
+
+///////////////////////////////////////////////////////////////////
+// FR-FCFS pick among queued writes: the oldest row hit, else the
+// oldest. With idle_only, only writes that can be done, read
+// turnaround included, by idle_by once their bank and the data bus
+// have gone idle qualify. Returns wq_count if none does.
+///////////////////////////////////////////////////////////////////
+
+static uns dramctrl_pick_write(DRAM_Ctrl *ctrl, Flag idle_only, uns64 idle_by){
+  DRAM_Timing *tm = &ctrl->timing;
+  uns64 bus_end   = dramctrl_bus_end(ctrl);
+  uns64 worst     = tm->t_rp + tm->t_rcd + tm->t_cas + tm->t_burst + tm->t_wtr + tm->t_cas;
+  uns   pick      = ctrl->wq_count;
+
+  for(uns ii=0; ii<ctrl->wq_count; ii++){
+    DRAM_Bank *b = &ctrl->bank[ctrl->wq[ii].bank];
+    uns64 start  = dramctrl_max(dramctrl_max(b->busy_until, ctrl->wq[ii].arrival), bus_end);
+    if(idle_only && (start + worst > idle_by)){
+      continue;
+    }
+    if(b->row_valid && (b->open_row == ctrl->wq[ii].row)){
+      return ii;
+    }
+    if(pick == ctrl->wq_count){
+      pick = ii;
+    }
+  }
+  return pick;
+}
+
+///////////////////////////////////////////////////////////////////
+// Remove queued write ii and send it, no earlier than t. Returns
+// the cycle its data transfer ends.
+///////////////////////////////////////////////////////////////////
+
+static uns64 dramctrl_issue_write(DRAM_Ctrl *ctrl, uns ii, uns64 t){
+  DRAM_Req req = ctrl->wq[ii];
+  uns64 first;
+
+  for(uns kk=ii+1; kk<ctrl->wq_count; kk++){
+    ctrl->wq[kk-1] = ctrl->wq[kk];
+  }
+  ctrl->wq_count--;
+
+  uns64 start = dramctrl_max(t, dramctrl_max(req.arrival, ctrl->bank[req.bank].busy_until));
+  uns64 done  = dramctrl_issue(ctrl, req.bank, req.row, TRUE, start, &first);
+
+  ctrl->stat_write_done++;
+  ctrl->stat_write_delay += done - req.arrival;
+  return done;
+}
+
+///////////////////////////////////////////////////////////////////
+// Drain episode: send writes FR-FCFS from now on until the queue is
+// down to the low watermark
+///////////////////////////////////////////////////////////////////
+
+static void dramctrl_drain(DRAM_Ctrl *ctrl, uns64 now){
+  uns64 end = now;
+
+  ctrl->stat_drains++;
+  while(ctrl->wq_count > ctrl->wq_low){
+    uns64 done = dramctrl_issue_write(ctrl, dramctrl_pick_write(ctrl, FALSE, 0), now);
+    end = dramctrl_max(end, done);
+    ctrl->stat_drain_writes++;
+  }
+  ctrl->stat_drain_cycles += end - now;
+}
+
+///////////////////////////////////////////////////////////////////
+// A read returns its latency. A write returns 0: it is queued, and
+// one that fills the queue to the high watermark starts a drain.
+///////////////////////////////////////////////////////////////////
+
+uns64      dramctrl_access(DRAM_Ctrl *ctrl, uns bank, uns64 row, Flag is_write, uns64 now){
+  uns pick;
+
+  assert(bank < ctrl->num_banks);
+
+  // writes that fit in an idle stretch of their bank and the bus
+  // before now, turnaround included, went out in it
+  while((pick = dramctrl_pick_write(ctrl, TRUE, now)) < ctrl->wq_count){
+    dramctrl_issue_write(ctrl, pick, dramctrl_bus_end(ctrl));
+  }
+  ctrl->last_arrival = now;
+
+  if(is_write){
+    ctrl->wq[ctrl->wq_count].bank    = bank;
+    ctrl->wq[ctrl->wq_count].row     = row;
+    ctrl->wq[ctrl->wq_count].arrival = now;
+    ctrl->wq_count++;
+    if(ctrl->wq_count >= ctrl->wq_high){
+      dramctrl_drain(ctrl, now);
+    }
+    return 0;
+  }
+
+  uns64 first;
+  uns64 done = dramctrl_issue(ctrl, bank, row, FALSE, now, &first);
+
+  ctrl->stat_read_done++;
+  ctrl->stat_read_queue_delay += first - now;
+  return done - now;
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+void       dramctrl_print_stats(DRAM_Ctrl *ctrl, char *header){
+  double rq_delay_avg=0;
+  double bus_util=0;
+  double drain_writes_avg=0;
+  double drain_cycles_avg=0;
+
+  if(ctrl->stat_read_done){
+    rq_delay_avg = (double)(ctrl->stat_read_queue_delay)/(double)(ctrl->stat_read_done);
+  }
+  if(ctrl->stat_drains){
+    drain_writes_avg = (double)(ctrl->stat_drain_writes)/(double)(ctrl->stat_drains);
+    drain_cycles_avg = (double)(ctrl->stat_drain_cycles)/(double)(ctrl->stat_drains);
+  }
+  if(cycle){
+    bus_util = (double)(ctrl->stat_bus_busy)/(double)(cycle);
+  }
+
+  printf("\n%s_READ_QUEUE_DELAY_AVG\t : %10.3f", header, rq_delay_avg);
+  printf("\n%s_WRITES_PENDING   \t : %10u", header, ctrl->wq_count);
+  printf("\n%s_DRAINS          \t : %10llu", header, ctrl->stat_drains);
+  printf("\n%s_DRAIN_WRITES_AVG \t : %10.3f", header, drain_writes_avg);
+  printf("\n%s_DRAIN_CYCLES_AVG \t : %10.3f", header, drain_cycles_avg);
+  printf("\n%s_WTR_TURNAROUNDS  \t : %10llu", header, ctrl->stat_wtr_turnarounds);
+  printf("\n%s_BUS_UTIL_PERC    \t : %10.3f", header, 100*bus_util);
+  printf("\n");
+}
@@ -0,0 +1,163 @@
+#ifndef DRAMCTRL_H
+#define DRAMCTRL_H
+
+#include "types.h"
+
+#define DRAMCTRL_MAX_BANKS   256
+#define DRAMCTRL_BUS_SLOTS   1024
+#define DRAMCTRL_WQ_SIZE     64
+
+// Page management policies (-drampage)
+#define PAGE_POLICY_OPEN       0  // leave the row open until a conflict
+#define PAGE_POLICY_CLOSED     1  // precharge after every access
+#define PAGE_POLICY_TIMEOUT    2  // precharge once the row has been idle a while
+#define PAGE_POLICY_ADAPTIVE   3  // per-bank predictor picks open or closed
+
+// Row buffer outcome of an access
+#define DRAM_ROW_HIT         0
+#define DRAM_ROW_CONFLICT    1  // another row was open
+#define DRAM_ROW_EMPTY       2  // the bank was precharged
+#define DRAM_ROW_OUTCOMES    3
+
+#define DRAM_PAGE_PRED_MAX   3  // adaptive: 2-bit counter, close the row at >= 2
+
+// Refresh modes (-dramrefresh)
+#define DRAM_REFRESH_OFF      0
+#define DRAM_REFRESH_ALLBANK  1  // a rank refreshes all its banks at once
+#define DRAM_REFRESH_PERBANK  2  // banks refresh one at a time
+
+typedef struct DRAM_Timing DRAM_Timing;
+typedef struct DRAM_Refresh DRAM_Refresh;
+typedef struct DRAM_Bank   DRAM_Bank;
+typedef struct DRAM_Req    DRAM_Req;
+typedef struct DRAM_Burst  DRAM_Burst;
+typedef struct DRAM_Ctrl   DRAM_Ctrl;
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+// DRAM timing parameters, in core cycles
+struct DRAM_Timing {
+  uns64 t_rcd;    // ACT to CAS
+  uns64 t_cas;    // CAS to first data
+  uns64 t_rp;     // PRE to ACT
+  uns64 t_ras;    // ACT to PRE
+  uns64 t_burst;  // data bus occupancy of one line
+  uns64 t_wtr;    // end of write data to the next read CAS
+};
+
+// Refresh schedule of a channel. Every bank is refreshed once per
+// t_refi and is blocked for t_rfc each time. Refreshes are staggered
+// evenly over t_refi: rank by rank for all-bank refresh, bank by bank
+// for per-bank refresh. A refresh leaves the bank precharged.
+struct DRAM_Refresh {
+  uns   mode;
+  uns64 t_refi;
+  uns64 t_rfc;
+  uns   num_ranks;
+  uns   banks_per_rank;
+};
+
+// Per-bank state machine: the open row and the earliest cycle each
+// kind of command may issue next
+struct DRAM_Bank {
+  Flag  row_valid;
+  uns64 open_row;    // kept after a precharge, for the adaptive predictor
+  Flag  row_seen;    // open_row has been set at least once
+  uns   close_ctr;   // adaptive page predictor
+  uns64 act_cycle;   // last ACT, for tRAS
+  uns64 act_ready;   // tRP after the last PRE
+  uns64 cas_ready;   // tRCD after ACT, one burst after the last CAS
+  uns64 pre_ready;   // end of the last column access
+  uns64 busy_until;  // end of the last access booked on this bank
+};
+
+struct DRAM_Req {
+  uns   bank;
+  uns64 row;
+  uns64 arrival;
+};
+
+struct DRAM_Burst {
+  uns64 start;
+  Flag  is_write;
+};
+
+// Controller in front of the banks. Callers block on reads, so a
+// read is booked on its bank and on the data bus the moment it
+// arrives, ahead of any queued write, and its latency is its actual
+// completion time: waiting for the bank (tRAS/tRP/tRCD of earlier
+// accesses) and for a free burst slot on the shared data bus.
+//
+// Writes are posted into the write queue. At every arrival the queue
+// is scanned FR-FCFS (row hits first, then oldest) and writes that
+// fit in an idle stretch of their bank and the bus before the new
+// arrival are issued in it. When the
+// queue reaches the high watermark the controller drains it, FR-FCFS
+// and ahead of any later read, down to the low watermark. A read
+// whose data follows a write burst pays the write-to-read turnaround
+// (tWTR, then tCAS) on the data bus, which is what batching saves.
+
+struct DRAM_Ctrl {
+  DRAM_Timing timing;
+  DRAM_Refresh refresh;
+  uns         num_banks;
+  uns         page_policy;
+  uns64       page_timeout;  // idle cycles before PAGE_POLICY_TIMEOUT precharges
+  DRAM_Bank   bank[DRAMCTRL_MAX_BANKS];
+
+  DRAM_Req    wq[DRAMCTRL_WQ_SIZE];   // in arrival order
+  uns         wq_count;
+  uns         wq_high;     // start a drain at this many writes
+  uns         wq_low;      // and stop it at this many
+
+  DRAM_Burst  bus_slot[DRAMCTRL_BUS_SLOTS]; // booked bursts, by start cycle
+  uns         bus_slots;
+  uns64       last_arrival;
+
+  // stats
+  uns64 stat_read_done;
+  uns64 stat_read_queue_delay; // arrival to first command
+  uns64 stat_write_done;
+  uns64 stat_write_delay;      // arrival to end of data
+  uns64 stat_bus_busy;
+  uns64 stat_drains;
+  uns64 stat_drain_writes;
+  uns64 stat_drain_cycles;     // drain start to end of its last write
+  uns64 stat_wtr_turnarounds;  // reads booked right after a write burst
+  uns64 stat_row[DRAM_ROW_OUTCOMES];
+  uns64 stat_refresh_delay;    // read cycles spent waiting for a refresh
+  uns64 stat_refresh_closes;   // open rows closed by a refresh
+};
+
+
+
+//////////////////////////////////////////////////////////////////
+// Adaptive page policy, shared with the closed-form model: keeping
+// a row open pays off when the next access to the bank reuses it
+// (reuse), and costs a precharge when it goes elsewhere.
+//////////////////////////////////////////////////////////////////
+
+static inline uns dram_page_pred_update(uns close_ctr, Flag reuse){
+  if(reuse){
+    return close_ctr ? close_ctr-1 : 0;
+  }
+  return (close_ctr < DRAM_PAGE_PRED_MAX) ? close_ctr+1 : close_ctr;
+}
+
+static inline Flag dram_page_pred_close(uns close_ctr){
+  return close_ctr >= 2;
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+DRAM_Ctrl *dramctrl_new(DRAM_Timing *timing, DRAM_Refresh *refresh, uns num_banks,
+                        uns page_policy, uns64 page_timeout, uns wq_high, uns wq_low);
+uns64      dramctrl_access(DRAM_Ctrl *ctrl, uns bank, uns64 row, Flag is_write, uns64 now);
+void       dramctrl_print_stats(DRAM_Ctrl *ctrl, char *header);
+uns64      dramctrl_refresh_ready(DRAM_Refresh *refresh, uns bank, uns64 t, uns64 *ref_start);
+
+
+
+#endif // DRAMCTRL_H
@@ -0,0 +1,222 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dramtiming.h"
+
+extern void die_message(const char * msg);
+
+extern uns64  CORE_FREQ_MHZ;
+
+// Speed grades at JEDEC-typical bins. DDR3/DDR4 have no per-bank
+// refresh command, their tRFCpb is an estimate for what-if studies.
+// Energies assume 8 x8 chips per rank (4 x16 for LPDDR4); legacy
+// reuses DDR4-3200's. HBM2 is one 128-bit channel of a stack, with
+// its energies per pseudo-rank; it is meant for the DRAM cache.
+static const DRAM_Timing_Spec dramtiming_presets[] = {
+  // name          MT/s  tCL tRCD tRP tRAS tBURST tWTR tREFI  tRFC tRFCpb   eACT  eRD  eWR   eREF pBG
+  {"legacy",          0,  45,  45, 45,  90,   10,  24, 25000, 1120,  290,  7600, 2520, 2760, 688800, 432},
+  {"DDR3-1600",    1600,  11,  11, 11,  28,    4,   6,  7800,  260,   90, 15400, 8100, 8400, 530400, 540},
+  {"DDR4-2400",    2400,  17,  17, 17,  39,    4,   9,  7800,  350,  110,  7600, 2720, 2880, 688800, 432},
+  {"DDR4-3200",    3200,  22,  22, 22,  52,    4,  12,  7800,  350,  110,  7600, 2520, 2760, 688800, 432},
+  {"DDR5-4800",    4800,  40,  39, 39,  77,    8,  24,  3900,  295,  130,  9600, 3520, 3810, 597000, 440},
+  {"DDR5-6400",    6400,  52,  52, 52, 103,    8,  32,  3900,  295,  130,  9600, 3080, 3300, 597000, 440},
+  {"LPDDR4-3200",  3200,  28,  29, 29,  68,    8,  16,  3904,  280,  140,  3000, 2000, 2200, 123200, 110},
+  {"HBM2-2000",    2000,  14,  14, 14,  34,    2,   8,  3900,  260,  160,  1500, 1000, 1100,  60000,  60},
+};
+
+#define DRAMTIMING_NUM_PRESETS  (sizeof(dramtiming_presets)/sizeof(dramtiming_presets[0]))
+
+static DRAM_Timing_Spec dramtiming_spec = dramtiming_presets[0];
+
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+const DRAM_Timing_Spec *dramtiming_find(const char *name){
+  for(uns ii=0; ii<DRAMTIMING_NUM_PRESETS; ii++){
+    if(!strcasecmp(name, dramtiming_presets[ii].name)){
+      return &dramtiming_presets[ii];
+    }
+  }
+  return NULL;
+}
+
+///////////////////////////////////////////////////////////////////
+// The main memory's timing, from -dramtiming/-dramcfg
+///////////////////////////////////////////////////////////////////
+
+const DRAM_Timing_Spec *dramtiming_current(void){
+  return &dramtiming_spec;
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+Flag    dramtiming_set_preset(const char *name){
+  const DRAM_Timing_Spec *spec = dramtiming_find(name);
+  if(spec == NULL){
+    return FALSE;
+  }
+  dramtiming_spec = *spec;
+  return TRUE;
+}
+
+///////////////////////////////////////////////////////////////////
+// Parse one config line, returns FALSE on a malformed line
+///////////////////////////////////////////////////////////////////
+
+Flag    dramtiming_parse_line(const char *line){
+  char  buf[256];
+  char *key, *value, *extra;
+
+  strncpy(buf, line, sizeof(buf)-1);
+  buf[sizeof(buf)-1] = 0;
+
+  char *comment = strchr(buf, '#');
+  if(comment){
+    *comment = 0;
+  }
+
+  key   = strtok(buf, " \t\r\n");
+  value = strtok(NULL, " \t\r\n");
+  extra = strtok(NULL, " \t\r\n");
+  if(key == NULL){
+    return TRUE; // blank line
+  }
+  if((value == NULL) || extra){
+    return FALSE;
+  }
+
+  if(!strcmp(key, "preset")){
+    return dramtiming_set_preset(value);
+  }
+
+  struct { const char *key; uns64 *field; } fields[] = {
+    {"data_rate", &dramtiming_spec.data_rate},
+    {"tCL",       &dramtiming_spec.t_cl},
+    {"tRCD",      &dramtiming_spec.t_rcd},
+    {"tRP",       &dramtiming_spec.t_rp},
+    {"tRAS",      &dramtiming_spec.t_ras},
+    {"tBURST",    &dramtiming_spec.t_burst},
+    {"tWTR",      &dramtiming_spec.t_wtr},
+    {"tREFI",     &dramtiming_spec.t_refi},
+    {"tRFC",      &dramtiming_spec.t_rfc},
+    {"tRFCpb",    &dramtiming_spec.t_rfc_pb},
+    {"eACT",      &dramtiming_spec.e_act},
+    {"eRD",       &dramtiming_spec.e_rd},
+    {"eWR",       &dramtiming_spec.e_wr},
+    {"eREF",      &dramtiming_spec.e_ref},
+    {"pBG",       &dramtiming_spec.p_bg},
+  };
+
+  for(uns ii=0; ii<sizeof(fields)/sizeof(fields[0]); ii++){
+    if(!strcmp(key, fields[ii].key)){
+      char *end;
+      *fields[ii].field = strtoull(value, &end, 0);
+      if(*end){
+        return FALSE;
+      }
+      snprintf(dramtiming_spec.name, sizeof(dramtiming_spec.name), "custom");
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+void    dramtiming_load_config(const char *fname){
+  char line[256];
+  char msg[512];
+  uns  lineno = 0;
+  FILE *fp = fopen(fname, "r");
+
+  if(fp == NULL){
+    snprintf(msg, sizeof(msg), "Unable to open DRAM timing config %s", fname);
+    die_message(msg);
+  }
+
+  while(fgets(line, sizeof(line), fp)){
+    lineno++;
+    if(!dramtiming_parse_line(line)){
+      snprintf(msg, sizeof(msg), "Bad DRAM timing config line %u in %s", lineno, fname);
+      die_message(msg);
+    }
+  }
+
+  fclose(fp);
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+Flag    dramtiming_is_legacy(const DRAM_Timing_Spec *spec){
+  return !strcmp(spec->name, dramtiming_presets[0].name);
+}
+
+///////////////////////////////////////////////////////////////////
+// Round up, so that a timing is never shorter than specified
+///////////////////////////////////////////////////////////////////
+
+static uns64 dramtiming_clk_to_cycles(const DRAM_Timing_Spec *spec, uns64 clk){
+  if(spec->data_rate == 0){
+    return clk;
+  }
+  return (2*clk*CORE_FREQ_MHZ + spec->data_rate - 1)/spec->data_rate;
+}
+
+static uns64 dramtiming_ns_to_cycles(const DRAM_Timing_Spec *spec, uns64 ns){
+  if(spec->data_rate == 0){
+    return ns;
+  }
+  return (ns*CORE_FREQ_MHZ + 999)/1000;
+}
+
+///////////////////////////////////////////////////////////////////
+// Core-cycle timings; refresh->mode picks the tRFC that applies
+///////////////////////////////////////////////////////////////////
+
+void    dramtiming_get(const DRAM_Timing_Spec *spec, DRAM_Timing *timing, DRAM_Refresh *refresh){
+  if((spec->t_burst == 0) || (spec->t_refi == 0) || (CORE_FREQ_MHZ == 0)){
+    die_message("DRAM timing needs a non-zero tBURST, tREFI and core frequency");
+  }
+
+  timing->t_rcd   = dramtiming_clk_to_cycles(spec, spec->t_rcd);
+  timing->t_cas   = dramtiming_clk_to_cycles(spec, spec->t_cl);
+  timing->t_rp    = dramtiming_clk_to_cycles(spec, spec->t_rp);
+  timing->t_ras   = dramtiming_clk_to_cycles(spec, spec->t_ras);
+  timing->t_burst = dramtiming_clk_to_cycles(spec, spec->t_burst);
+  timing->t_wtr   = dramtiming_clk_to_cycles(spec, spec->t_wtr);
+
+  refresh->t_refi = dramtiming_ns_to_cycles(spec, spec->t_refi);
+  refresh->t_rfc  = dramtiming_ns_to_cycles(spec, (refresh->mode == DRAM_REFRESH_PERBANK) ?
+                                                  spec->t_rfc_pb : spec->t_rfc);
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+void    dramtiming_get_energy(const DRAM_Timing_Spec *spec, DRAM_Energy *energy){
+  energy->e_act = spec->e_act;
+  energy->e_rd  = spec->e_rd;
+  energy->e_wr  = spec->e_wr;
+  energy->e_ref = spec->e_ref;
+  energy->p_bg  = spec->p_bg;
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+void    dramtiming_print(const DRAM_Timing_Spec *spec, DRAM_Timing *timing, char *header){
+  printf("\n%s_TIMING           \t : %10s", header, spec->name);
+  printf("\n%s_DATA_RATE        \t : %10llu", header, spec->data_rate);
+  printf("\n%s_T_RCD            \t : %10llu", header, timing->t_rcd);
+  printf("\n%s_T_CAS            \t : %10llu", header, timing->t_cas);
+  printf("\n%s_T_RP             \t : %10llu", header, timing->t_rp);
+  printf("\n%s_T_RAS            \t : %10llu", header, timing->t_ras);
+  printf("\n%s_T_BURST          \t : %10llu", header, timing->t_burst);
+  printf("\n%s_T_WTR            \t : %10llu", header, timing->t_wtr);
+}
@@ -0,0 +1,78 @@
+#ifndef DRAMTIMING_H
+#define DRAMTIMING_H
+
+#include "types.h"
+#include "dramctrl.h"
+
+typedef struct DRAM_Timing_Spec DRAM_Timing_Spec;
+typedef struct DRAM_Energy      DRAM_Energy;
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+// DRAM timings the way datasheets give them: core timings in DRAM
+// clocks (tCK = 2000/data_rate ns), refresh in ns. They are turned
+// into core cycles at CORE_FREQ_MHZ when the DRAM is built. With a
+// data_rate of 0 every value is already in core cycles (the legacy
+// preset, which is the default).
+//
+// Presets are picked with -dramtiming <name>, or from a config file
+// (-dramcfg) with one "key value" pair per line:
+//
+//   # comment
+//   preset    DDR4-3200   # start from a preset, then override
+//   data_rate 3200        # MT/s
+//   tCL       22          # DRAM clocks: tCL tRCD tRP tRAS tBURST tWTR
+//   tREFI     7800        # ns: tREFI tRFC tRFCpb
+//   eACT      7600        # pJ per rank: eACT eRD eWR eREF, mW per rank: pBG
+//
+// Energies are per rank (a 64-bit wide set of chips), worked out from
+// datasheet IDD currents the usual way, e.g. for an ACT/PRE pair
+// VDD*(IDD0*tRC - IDD3N*tRAS - IDD2N*(tRC-tRAS)) times chips per rank.
+
+struct DRAM_Timing_Spec {
+  char  name[32];
+  uns64 data_rate;
+  uns64 t_cl;
+  uns64 t_rcd;
+  uns64 t_rp;
+  uns64 t_ras;
+  uns64 t_burst;     // BL/2 clocks per line
+  uns64 t_wtr;
+  uns64 t_refi;
+  uns64 t_rfc;       // all-bank refresh
+  uns64 t_rfc_pb;    // per-bank refresh
+  uns64 e_act;       // ACT and the PRE that closes the row
+  uns64 e_rd;        // one read burst
+  uns64 e_wr;        // one write burst
+  uns64 e_ref;       // one all-bank refresh
+  uns64 p_bg;        // standby, rows open
+};
+
+// Per-rank energy per event in pJ, background power in mW
+struct DRAM_Energy {
+  uns64 e_act;
+  uns64 e_rd;
+  uns64 e_wr;
+  uns64 e_ref;
+  uns64 p_bg;
+};
+
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+const DRAM_Timing_Spec *dramtiming_find(const char *name);
+const DRAM_Timing_Spec *dramtiming_current(void);
+Flag    dramtiming_set_preset(const char *name);
+Flag    dramtiming_parse_line(const char *line);
+void    dramtiming_load_config(const char *fname);
+Flag    dramtiming_is_legacy(const DRAM_Timing_Spec *spec);
+void    dramtiming_get(const DRAM_Timing_Spec *spec, DRAM_Timing *timing, DRAM_Refresh *refresh);
+void    dramtiming_get_energy(const DRAM_Timing_Spec *spec, DRAM_Energy *energy);
+void    dramtiming_print(const DRAM_Timing_Spec *spec, DRAM_Timing *timing, char *header);
+
+
+
+#endif // DRAMTIMING_H
@@ -0,0 +1,205 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fairness.h"
+
+#define FAIRNESS_LINE_LEN   16384
+#define FAIRNESS_KEY_LEN    (FAIRNESS_LINE_LEN + 1100) // trace, tab, options
+
+extern char   FAIRNESS_CACHE_FILE[1024];
+
+extern void die_message(const char * msg);
+
+// options that only add stats or output files: not passed on, not in the key
+static const char *fairness_stat_opts[] = {
+  "-fairness", "-alonecache", "-missclass", "-pcprof", "-lathist",
+  "-dramsample", "-dramsamplefile", "-reuse", "-reuserate", "-reusewindow",
+  "-reusewsfile", NULL};
+
+// L2 partitioning: a core running alone has the whole L2
+static const char *fairness_partition_opts[] = {
+  "-SWP_core0ways", "-L2mask", "-L2maskcfg", "-UMONsample", "-UCPinterval", NULL};
+
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+static Flag fairness_listed(const char **list, char *opt){
+  for(uns ii=0; list[ii]; ii++){
+    if(!strcmp(list[ii], opt)){
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+///////////////////////////////////////////////////////////////////
+// Add one argument to the command line, single-quoted for the shell,
+// and to the cache key as is
+///////////////////////////////////////////////////////////////////
+
+static void fairness_quote(char *cmd, const char *arg){
+  if(strlen(cmd) + 4*strlen(arg) + 4 >= FAIRNESS_LINE_LEN){
+    die_message("Command line too long for the alone runs");
+  }
+
+  strcat(cmd, " '");
+  for(const char *p=arg; *p; p++){
+    if(*p == '\''){
+      strcat(cmd, "'\\''");
+    } else {
+      strncat(cmd, p, 1);
+    }
+  }
+  strcat(cmd, "'");
+}
+
+static void fairness_append(char *cmd, char *key, const char *arg){
+  if(strlen(key) + strlen(arg) + 2 >= FAIRNESS_LINE_LEN){
+    die_message("Command line too long for the alone runs");
+  }
+  fairness_quote(cmd, arg);
+
+  if(key[0]){
+    strcat(key, " ");
+  }
+  strcat(key, arg);
+}
+
+///////////////////////////////////////////////////////////////////
+// Every option takes one value; anything else is a trace
+///////////////////////////////////////////////////////////////////
+
+static void fairness_alone_config(int argc, char **argv, char *cmd, char *key){
+  for(int ii=1; ii<argc-1; ii++){
+    if(argv[ii][0] != '-'){
+      continue;
+    }
+    char *opt = argv[ii];
+    char *val = argv[ii+1];
+    ii += 1;
+
+    if(fairness_listed(fairness_stat_opts, opt) || fairness_listed(fairness_partition_opts, opt)){
+      continue;
+    }
+    if(!strcmp(opt, "-mode") && (atoi(val) >= SIM_MODE_E)){
+      val = (char *) "4";
+    }
+    if(!strcmp(opt, "-L2repl") && (atoi(val) >= REPL_SWP)){
+      continue;
+    }
+    fairness_append(cmd, key, opt);
+    fairness_append(cmd, key, val);
+  }
+}
+
+///////////////////////////////////////////////////////////////////
+// Cache lines are "<inst> <cycles>\t<trace>\t<options>"
+///////////////////////////////////////////////////////////////////
+
+static Flag fairness_cache_lookup(char *key, uns64 *inst, uns64 *cycles){
+  char  line[FAIRNESS_KEY_LEN + 64];
+  Flag  found = FALSE;
+  FILE *fp = fopen(FAIRNESS_CACHE_FILE, "r");
+
+  if(fp == NULL){
+    return FALSE;
+  }
+  while(!found && fgets(line, sizeof(line), fp)){
+    line[strcspn(line, "\n")] = 0;
+    char *tab = strchr(line, '\t');
+    if(tab && !strcmp(tab+1, key) && (sscanf(line, "%llu %llu", inst, cycles) == 2)){
+      found = TRUE;
+    }
+  }
+  fclose(fp);
+  return found;
+}
+
+static void fairness_cache_store(char *key, uns64 inst, uns64 cycles){
+  FILE *fp = fopen(FAIRNESS_CACHE_FILE, "a");
+
+  if(fp == NULL){
+    die_message("Unable to write the alone-IPC cache");
+  }
+  fprintf(fp, "%llu %llu\t%s\n", inst, cycles, key);
+  fclose(fp);
+}
+
+///////////////////////////////////////////////////////////////////
+// Run this simulator on the trace alone and read back its counts
+///////////////////////////////////////////////////////////////////
+
+static void fairness_run_alone(char *cmd, uns64 *inst, uns64 *cycles){
+  char  line[FAIRNESS_LINE_LEN];
+  FILE *fp = popen(cmd, "r");
+
+  if(fp == NULL){
+    printf("Command string is %s\n", cmd);
+    die_message("Unable to start the alone run");
+  }
+
+  *inst = *cycles = 0;
+  while(fgets(line, FAIRNESS_LINE_LEN, fp)){
+    sscanf(line, "CORE_0_INST : %llu", inst);
+    sscanf(line, "CORE_0_CYCLES : %llu", cycles);
+  }
+  pclose(fp);
+
+  if(*cycles == 0){
+    printf("Command string is %s\n", cmd);
+    die_message("Alone run did not report CORE_0 stats");
+  }
+}
+
+static double fairness_alone_ipc(int argc, char **argv, char *trace){
+  static char cmd[FAIRNESS_LINE_LEN];
+  static char key[FAIRNESS_KEY_LEN];
+  static char config[FAIRNESS_LINE_LEN];
+  uns64 inst, cycles;
+
+  cmd[0] = config[0] = 0;
+  fairness_quote(cmd, argv[0]);   // the binary is not part of the key
+
+  fairness_alone_config(argc, argv, cmd, config);
+  fairness_quote(cmd, trace);
+  sprintf(key, "%s\t%s", trace, config);
+
+  if(!fairness_cache_lookup(key, &inst, &cycles)){
+    fairness_run_alone(cmd, &inst, &cycles);
+    fairness_cache_store(key, inst, cycles);
+  }
+  return (double)(inst)/(double)(cycles);
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+void    fairness_print_stats(Core **core, uns num_cores, int argc, char **argv){
+  double ws = 0, inv_hs = 0;
+  double max_slowdown = 0, min_slowdown = 0;
+
+  printf("\n");
+  for(uns ii=0; ii<num_cores; ii++){
+    Core  *c = core[ii];
+    double shared_ipc = (double)(c->done_inst_count)/(double)(c->done_cycle_count);
+    double alone_ipc  = fairness_alone_ipc(argc, argv, c->trace_fname);
+    double slowdown   = alone_ipc/shared_ipc;
+
+    ws     += 1.0/slowdown;
+    inv_hs += slowdown;
+    max_slowdown = ((ii == 0) || (slowdown > max_slowdown)) ? slowdown : max_slowdown;
+    min_slowdown = ((ii == 0) || (slowdown < min_slowdown)) ? slowdown : min_slowdown;
+
+    printf("\nFAIRNESS_CORE_%u_ALONE_IPC\t\t : %10.3f", ii, alone_ipc);
+    printf("\nFAIRNESS_CORE_%u_SLOWDOWN \t\t : %10.3f", ii, slowdown);
+  }
+
+  printf("\nFAIRNESS_WEIGHTED_SPEEDUP \t\t : %10.3f", ws);
+  printf("\nFAIRNESS_HARMONIC_SPEEDUP \t\t : %10.3f", (double)(num_cores)/inv_hs);
+  printf("\nFAIRNESS_MAX_SLOWDOWN     \t\t : %10.3f", max_slowdown);
+  printf("\nFAIRNESS_UNFAIRNESS       \t\t : %10.3f", max_slowdown/min_slowdown);
+  printf("\n\n");
+}
@@ -0,0 +1,32 @@
+#ifndef FAIRNESS_H
+#define FAIRNESS_H
+
+#include "types.h"
+#include "core.h"
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+// Multiprogram metrics for a shared-L2 run (-fairness 1). Each core's
+// IPC is compared with the IPC of its trace running alone on the same
+// machine, with the L2 unpartitioned (SWP and UCP modes fall back to
+// mode 4). Alone runs are this simulator run again on one trace, and
+// their instruction and cycle counts are cached in a file keyed by
+// the trace and the options that change timing, so a sweep over
+// partitioning policies pays for them once.
+//
+//   slowdown_i        = alone_ipc_i / shared_ipc_i
+//   weighted speedup  = sum 1/slowdown_i
+//   harmonic speedup  = N / sum slowdown_i
+//   unfairness        = max slowdown / min slowdown
+
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+void    fairness_print_stats(Core **core, uns num_cores, int argc, char **argv);
+
+
+
+#endif // FAIRNESS_H
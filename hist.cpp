@@ -0,0 +1,77 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hist.h"
+
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+void    hist_reset(Hist *h){
+  memset(h, 0, sizeof(Hist));
+}
+
+///////////////////////////////////////////////////////////////////
+// Largest value that falls in bucket b
+///////////////////////////////////////////////////////////////////
+
+static uns64 hist_bucket_top(uns b){
+  if(b < 4){
+    return b;
+  }
+  uns e = (b>>2) - 1;
+  return ((uns64)((b&3) + 5) << e) - 1;
+}
+
+///////////////////////////////////////////////////////////////////
+// Smallest bucket top with at least perc% of the values at or
+// below it, capped by the largest value seen. Off by at most one
+// bucket width, i.e. 25%.
+///////////////////////////////////////////////////////////////////
+
+uns64   hist_percentile(Hist *h, double perc){
+  if(h->total == 0){
+    return 0;
+  }
+
+  uns64 rank = (uns64)((perc/100.0)*(double)(h->total));
+  if((double)(rank) < (perc/100.0)*(double)(h->total)){
+    rank++;
+  }
+  if(rank == 0){
+    rank = 1;
+  }
+
+  uns64 seen = 0;
+  for(uns b=0; b<HIST_BUCKETS; b++){
+    seen += h->count[b];
+    if(seen >= rank){
+      uns64 top = hist_bucket_top(b);
+      return (top < h->max) ? top : h->max;
+    }
+  }
+  return h->max;
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+double  hist_mean(Hist *h){
+  return h->total ? (double)(h->sum)/(double)(h->total) : 0;
+}
+
+///////////////////////////////////////////////////////////////////
+// Values below v, counted by whole buckets: exact when v starts a
+// bucket (any v up to 8, and every power of two above)
+///////////////////////////////////////////////////////////////////
+
+uns64   hist_count_below(Hist *h, uns64 v){
+  uns64 below = 0;
+
+  for(uns b=0; (b<HIST_BUCKETS) && (hist_bucket_top(b) < v); b++){
+    below += h->count[b];
+  }
+  return below;
+}
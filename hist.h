@@ -0,0 +1,50 @@
+#ifndef HIST_H
+#define HIST_H
+
+#include "types.h"
+
+#define HIST_BUCKETS  252  // covers all of uns64
+
+typedef struct Hist Hist;
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+// Log-linear histogram: values 0..3 get a bucket each, and every
+// power of two above is split into 4 equal buckets, so a bucket is
+// never wider than 25% of its values. With e = msb(v|4) - 2 the
+// bucket is (e<<2) + (v>>e), no branches and no loops, cheap enough
+// to fill on every access.
+
+struct Hist {
+  uns64 count[HIST_BUCKETS];
+  uns64 total;
+  uns64 sum;
+  uns64 max;
+};
+
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+static inline uns hist_bucket(uns64 v){
+  uns e = 61 - __builtin_clzll(v|4);
+  return (e<<2) + (uns)(v>>e);
+}
+
+static inline void hist_add(Hist *h, uns64 v){
+  h->count[hist_bucket(v)]++;
+  h->total++;
+  h->sum += v;
+  h->max  = (v > h->max) ? v : h->max;
+}
+
+void    hist_reset(Hist *h);
+uns64   hist_percentile(Hist *h, double perc);
+double  hist_mean(Hist *h);
+uns64   hist_count_below(Hist *h, uns64 v);
+
+
+
+#endif // HIST_H
@@ -0,0 +1,278 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcache.h"
+
+#define MCACHE_TAG_LATENCY   5   // SRAM tag lookup of the page organization
+#define MCACHE_TAG_BYTES     8   // Alloy keeps the tag next to the line
+
+extern uns64  CACHE_LINESIZE;
+extern uns64  MCACHE_SIZE;
+extern uns64  MCACHE_ORG;
+extern uns64  MCACHE_ASSOC;
+extern uns64  MCACHE_PAGE_SIZE;
+extern uns64  MCACHE_CHANNELS;
+extern uns64  DRAM_CTRL;
+extern char   MCACHE_TIMING[];
+extern uns64  cycle;
+
+
+///////////////////////////////////////////////////////////////////
+// The DRAM cache devices: HBM-like, many channels with wide rows,
+// timed by the same models as main memory.
+///////////////////////////////////////////////////////////////////
+
+MCache *mcache_new(DRAM *mem){
+  MCache *mc = (MCache *) calloc (1, sizeof (MCache));
+  DRAM_Config cfg;
+
+  mc->mem = mem;
+  mc->org = MCACHE_ORG;
+
+  if(MCACHE_ORG == MCACHE_ALLOY){
+    mc->num_ways        = 1;
+    mc->lines_per_block = 1;
+    mc->num_sets        = MCACHE_SIZE/(CACHE_LINESIZE + MCACHE_TAG_BYTES);
+  } else if(MCACHE_ORG == MCACHE_PAGE){
+    if((MCACHE_PAGE_SIZE < CACHE_LINESIZE) || (MCACHE_PAGE_SIZE % CACHE_LINESIZE) ||
+       (MCACHE_PAGE_SIZE/CACHE_LINESIZE > MCACHE_MAX_PAGE_LINES) || (MCACHE_ASSOC == 0)){
+      printf("DRAM cache pages must be 1 to %u lines, with at least one way\n", MCACHE_MAX_PAGE_LINES);
+      exit(-1);
+    }
+    mc->num_ways        = MCACHE_ASSOC;
+    mc->lines_per_block = MCACHE_PAGE_SIZE/CACHE_LINESIZE;
+    mc->num_sets        = MCACHE_SIZE/(MCACHE_PAGE_SIZE*MCACHE_ASSOC);
+  } else {
+    printf("Unknown DRAM cache organization %llu\n", MCACHE_ORG);
+    exit(-1);
+  }
+
+  if(mc->num_sets == 0){
+    printf("DRAM cache of %llu bytes holds no sets\n", MCACHE_SIZE);
+    exit(-1);
+  }
+  mc->entries = (MCache_Entry *) calloc (mc->num_sets*mc->num_ways, sizeof(MCache_Entry));
+
+  dram_default_config(&cfg);
+  snprintf(cfg.name, sizeof(cfg.name), "MCACHE_HBM");
+  cfg.spec          = dramtiming_find(MCACHE_TIMING);
+  cfg.channels      = MCACHE_CHANNELS;
+  cfg.ranks         = 1;
+  cfg.banks         = 16;
+  cfg.rowbuf_size   = 2048;
+  cfg.mapping       = DRAM_MAP_ROW_BANK_COL;
+  cfg.ch_interleave = cfg.rowbuf_size;
+  cfg.page_policy   = PAGE_POLICY_OPEN;
+  cfg.refresh       = DRAM_REFRESH_OFF;
+  cfg.t_refi        = 0;
+  cfg.t_rfc         = 0;
+  cfg.ctrl          = DRAM_CTRL;
+  cfg.sample_interval = 0;
+  assert(cfg.spec);
+  mc->dram = dram_new_config(&cfg);
+
+  return mc;
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+void    mcache_print_stats(MCache *mc, char *header){
+  double read_hit_perc=0, write_hit_perc=0, bloat=0;
+  uns64  demand_bytes = (mc->stat_read_access + mc->stat_write_access)*CACHE_LINESIZE;
+
+  if(mc->stat_read_access){
+    read_hit_perc = 100*(double)(mc->stat_read_hit)/(double)(mc->stat_read_access);
+  }
+  if(mc->stat_write_access){
+    write_hit_perc = 100*(double)(mc->stat_write_hit)/(double)(mc->stat_write_access);
+  }
+  if(demand_bytes){
+    bloat = (double)(mc->stat_dram_bytes + mc->stat_mem_bytes)/(double)(demand_bytes);
+  }
+
+  printf("\n%s_ORG              \t : %10s", header, (mc->org == MCACHE_ALLOY) ? "alloy" : "page");
+  printf("\n%s_READ_ACCESS      \t : %10llu", header, mc->stat_read_access);
+  printf("\n%s_READ_HIT_PERC    \t : %10.3f", header, read_hit_perc);
+  printf("\n%s_WRITE_ACCESS     \t : %10llu", header, mc->stat_write_access);
+  printf("\n%s_WRITE_HIT_PERC   \t : %10.3f", header, write_hit_perc);
+  printf("\n%s_FILL_LINES       \t : %10llu", header, mc->stat_fill_lines);
+  printf("\n%s_DIRTY_EVICT_LINES\t : %10llu", header, mc->stat_dirty_evict_lines);
+  printf("\n%s_HBM_BYTES        \t : %10llu", header, mc->stat_dram_bytes);
+  printf("\n%s_MEM_BYTES        \t : %10llu", header, mc->stat_mem_bytes);
+  printf("\n%s_BW_BLOAT         \t : %10.3f", header, bloat);
+  printf("\n");
+  dram_print_stats(mc->dram);
+}
+
+///////////////////////////////////////////////////////////////////
+// A read returns the delay seen by the L2 miss; writes are L2
+// writebacks, nobody waits for them.
+///////////////////////////////////////////////////////////////////
+
+uns64   mcache_access(MCache *mc, Addr lineaddr, Flag is_write){
+  if(is_write){
+    mc->stat_write_access++;
+  } else {
+    mc->stat_read_access++;
+  }
+
+  if(mc->org == MCACHE_ALLOY){
+    return mcache_access_alloy(mc, lineaddr, is_write);
+  }
+  return mcache_access_page(mc, lineaddr, is_write);
+}
+
+///////////////////////////////////////////////////////////////////
+// Main memory traffic, counted for the bloat stats
+///////////////////////////////////////////////////////////////////
+
+static uns64 mcache_mem_access(MCache *mc, Addr lineaddr, Flag is_write){
+  mc->stat_mem_bytes += CACHE_LINESIZE;
+  return dram_access(mc->mem, lineaddr, is_write);
+}
+
+static uns64 mcache_mem_fill(MCache *mc, Addr lineaddr){
+  mc->stat_mem_bytes += CACHE_LINESIZE;
+  return dram_background_read(mc->mem, lineaddr);
+}
+
+static uns64 mcache_dram_access(MCache *mc, Addr dram_lineaddr, uns64 bytes, Flag is_write){
+  mc->stat_dram_bytes += bytes;
+  return dram_access(mc->dram, dram_lineaddr, is_write);
+}
+
+// a DRAM cache read no request waits for
+static uns64 mcache_dram_background(MCache *mc, Addr dram_lineaddr, uns64 bytes){
+  mc->stat_dram_bytes += bytes;
+  return dram_background_read(mc->dram, dram_lineaddr);
+}
+
+///////////////////////////////////////////////////////////////////
+// TADs are packed into the DRAM cache rows (28 of 72B in 2KB), so
+// that streaming sets stay row buffer hits.
+///////////////////////////////////////////////////////////////////
+
+static Addr mcache_alloy_location(MCache *mc, uns64 set){
+  uns64 lines_per_row = mc->dram->cfg.rowbuf_size/CACHE_LINESIZE;
+  uns64 tads_per_row  = mc->dram->cfg.rowbuf_size/(CACHE_LINESIZE + MCACHE_TAG_BYTES);
+
+  return (set/tads_per_row)*lines_per_row + set%tads_per_row;
+}
+
+uns64   mcache_access_alloy(MCache *mc, Addr lineaddr, Flag is_write){
+  uns64 set = lineaddr % mc->num_sets;
+  Addr  loc = mcache_alloy_location(mc, set);
+  MCache_Entry *e = &mc->entries[set];
+  uns64 tad_bytes = CACHE_LINESIZE + MCACHE_TAG_BYTES;
+  uns64 delay;
+
+  // the tag only comes with the data, so every access starts with a TAD
+  // read; for an L2 writeback nothing waits on it
+  if(is_write){
+    delay = mcache_dram_background(mc, loc, tad_bytes);
+  } else {
+    delay = mcache_dram_access(mc, loc, tad_bytes, FALSE);
+  }
+  Flag hit = e->valid && (e->tag == lineaddr);
+
+  if(is_write){
+    if(!hit){
+      return mcache_mem_access(mc, lineaddr, TRUE); // write around
+    }
+    mc->stat_write_hit++;
+    e->dirty_mask = 1;
+    return mcache_dram_access(mc, loc, tad_bytes, TRUE);
+  }
+
+  if(hit){
+    mc->stat_read_hit++;
+    return delay;
+  }
+
+  delay += mcache_mem_access(mc, lineaddr, FALSE);
+
+  // the victim's data came with the TAD read
+  if(e->valid && e->dirty_mask){
+    mcache_mem_access(mc, e->tag, TRUE);
+    mc->stat_dirty_evict_lines++;
+  }
+  mcache_dram_access(mc, loc, tad_bytes, TRUE);
+  mc->stat_fill_lines++;
+
+  e->valid      = TRUE;
+  e->tag        = lineaddr;
+  e->dirty_mask = 0;
+  return delay;
+}
+
+///////////////////////////////////////////////////////////////////
+// A block's lines are consecutive in the DRAM cache, so filling a
+// page and reading it back are row buffer hits.
+///////////////////////////////////////////////////////////////////
+
+static Addr mcache_page_location(MCache *mc, uns64 set, uns way, uns offset){
+  return (set*mc->num_ways + way)*mc->lines_per_block + offset;
+}
+
+uns64   mcache_access_page(MCache *mc, Addr lineaddr, Flag is_write){
+  Addr   page   = lineaddr/mc->lines_per_block;
+  uns    offset = lineaddr%mc->lines_per_block;
+  uns64  set    = page % mc->num_sets;
+  MCache_Entry *ways = &mc->entries[set*mc->num_ways];
+  uns64  delay  = MCACHE_TAG_LATENCY;
+  uns    victim = 0;
+
+  for(uns ii=0; ii<mc->num_ways; ii++){
+    if(ways[ii].valid && (ways[ii].tag == page)){
+      Addr loc = mcache_page_location(mc, set, ii, offset);
+      ways[ii].last_access = cycle;
+      if(is_write){
+        mc->stat_write_hit++;
+        ways[ii].dirty_mask |= 1ULL << offset;
+      } else {
+        mc->stat_read_hit++;
+      }
+      return delay + mcache_dram_access(mc, loc, CACHE_LINESIZE, is_write);
+    }
+    if(!ways[ii].valid){
+      victim = ii;
+    } else if(ways[victim].valid && (ways[ii].last_access < ways[victim].last_access)){
+      victim = ii;
+    }
+  }
+
+  if(is_write){
+    return delay + mcache_mem_access(mc, lineaddr, TRUE); // write around
+  }
+
+  // the demand line goes first, the rest of the page follows off the critical path
+  delay += mcache_mem_access(mc, lineaddr, FALSE);
+
+  MCache_Entry *e = &ways[victim];
+  if(e->valid){
+    for(uns ii=0; ii<mc->lines_per_block; ii++){
+      if(e->dirty_mask & (1ULL << ii)){
+        mcache_dram_background(mc, mcache_page_location(mc, set, victim, ii), CACHE_LINESIZE);
+        mcache_mem_access(mc, e->tag*mc->lines_per_block + ii, TRUE);
+        mc->stat_dirty_evict_lines++;
+      }
+    }
+  }
+
+  for(uns ii=0; ii<mc->lines_per_block; ii++){
+    if(ii != offset){
+      mcache_mem_fill(mc, page*mc->lines_per_block + ii);
+    }
+    mcache_dram_access(mc, mcache_page_location(mc, set, victim, ii), CACHE_LINESIZE, TRUE);
+    mc->stat_fill_lines++;
+  }
+
+  e->valid       = TRUE;
+  e->tag         = page;
+  e->dirty_mask  = 0;
+  e->last_access = cycle;
+  return delay;
+}
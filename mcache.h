@@ -0,0 +1,77 @@
+#ifndef MCACHE_H
+#define MCACHE_H
+
+#include "types.h"
+#include "dram.h"
+
+#define MCACHE_ALLOY          0  // direct-mapped, tag and data read together
+#define MCACHE_PAGE           1  // page-sized blocks, tags in SRAM
+
+#define MCACHE_MAX_PAGE_LINES 64 // one dirty bit per line in a uns64
+
+typedef struct MCache       MCache;
+typedef struct MCache_Entry MCache_Entry;
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+// DRAM cache between the L2 and main memory, built from a stacked
+// HBM-like DRAM that has its own channels and timing. Two ways to
+// organize it:
+//
+// Alloy (Qureshi & Loh, MICRO'12): direct-mapped, each line is kept
+// next to its 8-byte tag, so one 72-byte TAD burst returns both and
+// a hit costs a single DRAM cache access. A miss has already paid for
+// the TAD read before it goes to memory.
+//
+// Page: set-associative with page-sized blocks and the tags in SRAM
+// (the Footprint/Unison family without the footprint predictor), so
+// hits and misses are known up front, but a miss fetches the whole
+// page from memory and a dirty victim page writes back line by line.
+//
+// Every byte moved on either DRAM beyond the 64 bytes the L2 asked for
+// is bandwidth bloat (Chou et al., ISCA'15): tag reads, fills of lines
+// that are never used, and writebacks.
+
+struct MCache_Entry {
+  Flag   valid;
+  Addr   tag;          // lineaddr (Alloy) or page number (Page)
+  uns64  dirty_mask;   // one bit per line of the block
+  uns64  last_access;  // for LRU
+};
+
+struct MCache {
+  uns     org;
+  uns64   num_sets;
+  uns     num_ways;
+  uns     lines_per_block;  // 1 for Alloy
+  MCache_Entry *entries;    // [set*num_ways + way]
+
+  DRAM   *dram;             // the DRAM cache's own devices
+  DRAM   *mem;              // main memory behind it
+
+  // stats
+  uns64 stat_read_access;
+  uns64 stat_read_hit;
+  uns64 stat_write_access;
+  uns64 stat_write_hit;
+  uns64 stat_fill_lines;
+  uns64 stat_dirty_evict_lines;
+  uns64 stat_dram_bytes;    // on the DRAM cache
+  uns64 stat_mem_bytes;     // on main memory
+};
+
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+MCache *mcache_new(DRAM *mem);
+void    mcache_print_stats(MCache *mc, char *header);
+uns64   mcache_access(MCache *mc, Addr lineaddr, Flag is_write);
+uns64   mcache_access_alloy(MCache *mc, Addr lineaddr, Flag is_write);
+uns64   mcache_access_page(MCache *mc, Addr lineaddr, Flag is_write);
+
+
+
+#endif // MCACHE_H
@@ -13,6 +13,8 @@
 #define DCACHE_HIT_LATENCY   1
 #define ICACHE_HIT_LATENCY   1
 #define L2CACHE_HIT_LATENCY  10
+#define VCACHE_HIT_LATENCY   1  // extra, after the DCACHE miss
+#define WBB_HIT_LATENCY      1  // extra, line forwarded from the writeback buffer
 
 extern MODE   SIM_MODE;
 extern uns64  CACHE_LINESIZE;
@@ -24,8 +26,21 @@ extern uns64  ICACHE_SIZE;
 extern uns64  ICACHE_ASSOC; 
 extern uns64  L2CACHE_SIZE; 
 extern uns64  L2CACHE_ASSOC;
+extern uns64  L2CACHE_PACKED;
 extern uns64  L2CACHE_REPL;
+extern uns64  L2CACHE_DBP;
+extern uns64  SWP_CORE0_WAYS;
+extern uns64  L2CACHE_SAMPLE;
+extern uns64  VCACHE_ENTRIES;
+extern uns64  WBB_ENTRIES;
+extern uns64  L1CACHE_INDEX;
+extern uns64  L2CACHE_INDEX;
 extern uns64  NUM_CORES;
+extern uns64  TLB_ENABLE;
+extern uns64  MCACHE_SIZE;
+extern uns64  LAT_HIST;
+extern uns64  MISS_CLASS;
+extern uns64  PCPROF_TOP;
 extern uns64 	cycle;
 
 ////////////////////////////////////////////////////////////////////
@@ -37,42 +52,151 @@ Memsys *memsys_new(void)
   Memsys *sys = (Memsys *) calloc (1, sizeof (Memsys));
 
   if(SIM_MODE==SIM_MODE_A){
-    sys->dcache = cache_new(DCACHE_SIZE, DCACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY);
+    sys->dcache = cache_new(DCACHE_SIZE, DCACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY, CACHE_LEVEL_L1);
   }
 
   if(SIM_MODE==SIM_MODE_B){
-    sys->dcache = cache_new(DCACHE_SIZE, DCACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY);
-    sys->icache = cache_new(ICACHE_SIZE, ICACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY);
-    sys->l2cache = cache_new(L2CACHE_SIZE, L2CACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY);
+    sys->dcache = cache_new(DCACHE_SIZE, DCACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY, CACHE_LEVEL_L1);
+    sys->icache = cache_new(ICACHE_SIZE, ICACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY, CACHE_LEVEL_L1);
+    sys->l2cache = cache_new(L2CACHE_SIZE, L2CACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY, CACHE_LEVEL_L2);
     sys->dram    = dram_new();
+    if(VCACHE_ENTRIES){
+      sys->vcache = cache_new(VCACHE_ENTRIES*CACHE_LINESIZE, VCACHE_ENTRIES, CACHE_LINESIZE, REPL_LRU, CACHE_LEVEL_L1);
+    }
+    if(WBB_ENTRIES){
+      sys->wbb = wbb_new(WBB_ENTRIES);
+    }
   }
 
   if(SIM_MODE==SIM_MODE_C){
-    sys->dcache = cache_new(DCACHE_SIZE, DCACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY);
-    sys->icache = cache_new(ICACHE_SIZE, ICACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY);
-    sys->l2cache = cache_new(L2CACHE_SIZE, L2CACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY);
+    sys->dcache = cache_new(DCACHE_SIZE, DCACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY, CACHE_LEVEL_L1);
+    sys->icache = cache_new(ICACHE_SIZE, ICACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY, CACHE_LEVEL_L1);
+    sys->l2cache = cache_new(L2CACHE_SIZE, L2CACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY, CACHE_LEVEL_L2);
     sys->dram    = dram_new();
+    if(VCACHE_ENTRIES){
+      sys->vcache = cache_new(VCACHE_ENTRIES*CACHE_LINESIZE, VCACHE_ENTRIES, CACHE_LINESIZE, REPL_LRU, CACHE_LEVEL_L1);
+    }
+    if(WBB_ENTRIES){
+      sys->wbb = wbb_new(WBB_ENTRIES);
+    }
   }
 
-  if( (SIM_MODE==SIM_MODE_D) || (SIM_MODE==SIM_MODE_E)) {
-    sys->l2cache = cache_new(L2CACHE_SIZE, L2CACHE_ASSOC, CACHE_LINESIZE, L2CACHE_REPL);
+  if( (SIM_MODE==SIM_MODE_D) || (SIM_MODE==SIM_MODE_E) || (SIM_MODE==SIM_MODE_F)) {
+    sys->l2cache = cache_new(L2CACHE_SIZE, L2CACHE_ASSOC, CACHE_LINESIZE, L2CACHE_REPL, CACHE_LEVEL_L2);
     sys->dram    = dram_new();
+    if(L2CACHE_REPL == REPL_UCP){
+      sys->umon = umon_new(NUM_CORES, sys->l2cache);
+    }
     uns ii;
     for(ii=0; ii<NUM_CORES; ii++){
-      sys->dcache_coreid[ii] = cache_new(DCACHE_SIZE, DCACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY);
-      sys->icache_coreid[ii] = cache_new(ICACHE_SIZE, ICACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY);
+      sys->dcache_coreid[ii] = cache_new(DCACHE_SIZE, DCACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY, CACHE_LEVEL_L1);
+      sys->icache_coreid[ii] = cache_new(ICACHE_SIZE, ICACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY, CACHE_LEVEL_L1);
+      if(VCACHE_ENTRIES){
+        sys->vcache_coreid[ii] = cache_new(VCACHE_ENTRIES*CACHE_LINESIZE, VCACHE_ENTRIES, CACHE_LINESIZE, REPL_LRU, CACHE_LEVEL_L1);
+      }
+      if(WBB_ENTRIES){
+        sys->wbb_coreid[ii] = wbb_new(WBB_ENTRIES);
+      }
+      if(TLB_ENABLE){
+        sys->tlb_coreid[ii] = tlb_new(ii);
+      }
+    }
+  }
+
+  // non-default set index functions (the default is picked by cache_new)
+  if(L1CACHE_INDEX != CACHE_INDEX_MASK){
+    Cache *l1[] = {sys->dcache, sys->icache};
+    for(uns jj=0; jj<2; jj++){
+      if(l1[jj]){
+        cache_set_index_fn(l1[jj], (Cache_Index_Fn) L1CACHE_INDEX);
+      }
+    }
+    for(uns ii=0; ii<NUM_CORES; ii++){
+      if(sys->dcache_coreid[ii]){
+        cache_set_index_fn(sys->dcache_coreid[ii], (Cache_Index_Fn) L1CACHE_INDEX);
+        cache_set_index_fn(sys->icache_coreid[ii], (Cache_Index_Fn) L1CACHE_INDEX);
+      }
+    }
+  }
+  if(sys->l2cache && (L2CACHE_INDEX != CACHE_INDEX_MASK)){
+    cache_set_index_fn(sys->l2cache, (Cache_Index_Fn) L2CACHE_INDEX);
+  }
+
+  if(sys->dram && MCACHE_SIZE && (SIM_MODE!=SIM_MODE_B)){
+    sys->mcache = mcache_new(sys->dram);
+  }
+
+  sys->cat_next_cycle = CAT_NO_EVENT;
+  if(sys->l2cache){
+    if(L2CACHE_PACKED){
+      cache_enable_packing(sys->l2cache);
+    }
+    if(L2CACHE_SAMPLE > 1){
+      cache_enable_sampling(sys->l2cache, L2CACHE_SAMPLE);
+    }
+    if(L2CACHE_DBP){
+      cache_enable_dbp(sys->l2cache, L2CACHE_DBP);
+    }
+    memsys_init_l2_partition(sys);
+  }
+
+  if(PCPROF_TOP){
+    sys->pcprof = pcprof_new(PCPROF_TOP);
+  }
+
+  // after set sampling, which sizes the shadows
+  if(MISS_CLASS){
+    Cache *caches[] = {sys->dcache, sys->icache, sys->vcache, sys->l2cache};
+    for(uns jj=0; jj<4; jj++){
+      if(caches[jj]){
+        cache_enable_miss_class(caches[jj]);
+      }
+    }
+    for(uns ii=0; ii<NUM_CORES; ii++){
+      Cache *core_caches[] = {sys->dcache_coreid[ii], sys->icache_coreid[ii], sys->vcache_coreid[ii]};
+      for(uns jj=0; jj<3; jj++){
+        if(core_caches[jj]){
+          cache_enable_miss_class(core_caches[jj]);
+        }
+      }
     }
   }
 
   return sys;
 }
 
+////////////////////////////////////////////////////////////////////
+// Set up the L2 way masks: SWP gives core 0 the low SWP_CORE0_WAYS
+// ways (class 0) and every other core the rest (class 1), UCP starts
+// from its even split, and a way-mask schedule takes it from there.
+////////////////////////////////////////////////////////////////////
+
+void memsys_init_l2_partition(Memsys *sys)
+{
+  Cache *l2 = sys->l2cache;
+
+  if(SWP_CORE0_WAYS){
+    assert(SWP_CORE0_WAYS < l2->num_ways);
+    cache_set_clos_mask(l2, 0, (1ULL << SWP_CORE0_WAYS) - 1);
+    cache_set_clos_mask(l2, 1, ((1ULL << l2->num_ways) - 1) & ~((1ULL << SWP_CORE0_WAYS) - 1));
+    for(uns ii=1; ii<MAX_CORES; ii++){
+      cache_set_core_clos(l2, ii, 1);
+    }
+  }
+
+  if(sys->umon){
+    umon_apply_partition(sys->umon, l2);
+  }
+
+  sys->cat_next_cycle = cat_apply(l2, cycle);
+}
+
 
 ////////////////////////////////////////////////////////////////////
 // This function takes an ifetch/ldst access and returns the delay
 ////////////////////////////////////////////////////////////////////
 
-uns64 memsys_access(Memsys *sys, Addr addr, Access_Type type, uns core_id)
+uns64 memsys_access(Memsys *sys, Addr addr, Access_Type type, uns core_id, Addr pc)
 {
   uns delay=0;
 
@@ -80,6 +204,31 @@ uns64 memsys_access(Memsys *sys, Addr addr, Access_Type type, uns core_id)
   // all cache transactions happen at line granularity, so get lineaddr
   Addr lineaddr=addr/CACHE_LINESIZE;
 
+  // scheduled L2 way-mask changes
+  if(cycle >= sys->cat_next_cycle){
+    sys->cat_next_cycle = cat_apply(sys->l2cache, cycle);
+  }
+
+  // writebacks the L2 had time for since this core's last access
+  WBB *wbb = memsys_wbb(sys, core_id);
+  if(wbb){
+    wbb->stall_cycles = 0;
+    memsys_wbb_drain(sys, wbb, core_id);
+  }
+
+  if(sys->l2cache){
+    sys->l2cache->access_pc = pc;
+  }
+
+  // misses this access causes, for the per-PC profile
+  Cache *dcache = sys->dcache ? sys->dcache : sys->dcache_coreid[core_id];
+  uns64 l1_miss_before  = 0, l2_miss_before = 0;
+  uns64 mem_read_before = sys->mem_read_count;
+  if(sys->pcprof){
+    l1_miss_before = memsys_miss_count(dcache);
+    l2_miss_before = memsys_miss_count(sys->l2cache);
+  }
+
   if(SIM_MODE==SIM_MODE_A){
     delay = memsys_access_modeA(sys,lineaddr,type, core_id);
   }
@@ -88,7 +237,7 @@ uns64 memsys_access(Memsys *sys, Addr addr, Access_Type type, uns core_id)
     delay = memsys_access_modeBC(sys,lineaddr,type, core_id);
   }
 
-  if((SIM_MODE==SIM_MODE_D)||(SIM_MODE==SIM_MODE_E)){
+  if((SIM_MODE==SIM_MODE_D)||(SIM_MODE==SIM_MODE_E)||(SIM_MODE==SIM_MODE_F)){
     // printf("At memsys.cpp: %d\n", __LINE__);
     delay = memsys_access_modeDE(sys,lineaddr,type, core_id);
   }
@@ -111,6 +260,16 @@ uns64 memsys_access(Memsys *sys, Addr addr, Access_Type type, uns core_id)
 
   }
 
+  if(LAT_HIST){
+    hist_add(&sys->stat_delay_hist[core_id][type], delay);
+  }
+
+  if(sys->pcprof && (type != ACCESS_TYPE_IFETCH)){
+    pcprof_access(sys->pcprof, pc, core_id,
+                  memsys_miss_count(dcache) - l1_miss_before,
+                  memsys_miss_count(sys->l2cache) - l2_miss_before,
+                  sys->mem_read_count - mem_read_before, delay);
+  }
 
   return delay;
 }
@@ -151,6 +310,16 @@ void memsys_print_stats(Memsys *sys)
   printf("\n%s_STORE_AVGDELAY \t\t : %10.3f",  header, store_delay_avg);
   printf("\n");
 
+  if(LAT_HIST){
+    memsys_print_delay_hist(sys);
+  }
+
+  if(sys->pcprof){
+    sprintf(header, "PCPROF");
+    pcprof_print_stats(sys->pcprof, header);
+    sprintf(header, "MEMSYS");
+  }
+
    if(SIM_MODE==SIM_MODE_A){
     sprintf(header, "DCACHE");
     cache_print_stats(sys->dcache, header);
@@ -161,30 +330,111 @@ void memsys_print_stats(Memsys *sys)
 	cache_print_stats(sys->icache, header);
 	sprintf(header, "DCACHE");
     cache_print_stats(sys->dcache, header);
+    if(sys->vcache){
+      sprintf(header, "VCACHE");
+      memsys_print_vcache_stats(sys->vcache, header);
+    }
+    if(sys->wbb){
+      sprintf(header, "WBB");
+      wbb_print_stats(sys->wbb, header);
+    }
 	sprintf(header, "L2CACHE");
     cache_print_stats(sys->l2cache, header);
     dram_print_stats(sys->dram);
+    if(sys->mcache){
+      sprintf(header, "MCACHE");
+      mcache_print_stats(sys->mcache, header);
+    }
   }
 
-  if((SIM_MODE==SIM_MODE_D)||(SIM_MODE==SIM_MODE_E)){
-    assert(NUM_CORES==2); //Hardcoded
-	sprintf(header, "ICACHE_0");
-    cache_print_stats(sys->icache_coreid[0], header);
-	sprintf(header, "DCACHE_0");
-    cache_print_stats(sys->dcache_coreid[0], header);
-	sprintf(header, "ICACHE_1");
-    cache_print_stats(sys->icache_coreid[1], header);
-	sprintf(header, "DCACHE_1");
-    cache_print_stats(sys->dcache_coreid[1], header);
+  if((SIM_MODE==SIM_MODE_D)||(SIM_MODE==SIM_MODE_E)||(SIM_MODE==SIM_MODE_F)){
+    for(uns ii=0; ii<NUM_CORES; ii++){
+      sprintf(header, "ICACHE_%u", ii);
+      cache_print_stats(sys->icache_coreid[ii], header);
+      sprintf(header, "DCACHE_%u", ii);
+      cache_print_stats(sys->dcache_coreid[ii], header);
+      if(sys->vcache_coreid[ii]){
+        sprintf(header, "VCACHE_%u", ii);
+        memsys_print_vcache_stats(sys->vcache_coreid[ii], header);
+      }
+      if(sys->wbb_coreid[ii]){
+        sprintf(header, "WBB_%u", ii);
+        wbb_print_stats(sys->wbb_coreid[ii], header);
+      }
+    }
 	sprintf(header, "L2CACHE");
     cache_print_stats(sys->l2cache, header);
     dram_print_stats(sys->dram);
-    
+    if(sys->mcache){
+      sprintf(header, "MCACHE");
+      mcache_print_stats(sys->mcache, header);
+    }
+
+    for(uns ii=0; ii<NUM_CORES; ii++){
+      if(sys->tlb_coreid[ii]){
+        sprintf(header, "TLB_%u", ii);
+        tlb_print_stats(sys->tlb_coreid[ii], header);
+      }
+    }
+
+    if(sys->umon){
+      sprintf(header, "UCP");
+      umon_print_stats(sys->umon, header);
+    }
   }
 
 }
 
 
+////////////////////////////////////////////////////////////////////
+// Tail latency per core and access type, from the log-linear
+// histograms (each percentile is a bucket top, within 25%)
+////////////////////////////////////////////////////////////////////
+
+void memsys_print_delay_hist(Memsys *sys)
+{
+  const char *type_name[NUM_ACCESS_TYPES] = {"IFETCH", "LOAD", "STORE"};
+  char header[256];
+
+  for(uns ii=0; ii<NUM_CORES; ii++){
+    for(uns tt=0; tt<NUM_ACCESS_TYPES; tt++){
+      Hist *h = &sys->stat_delay_hist[ii][tt];
+      if(h->total == 0){
+        continue;
+      }
+      sprintf(header, "MEMSYS_%u_%s", ii, type_name[tt]);
+      printf("\n%s_DELAY_P50   \t\t : %10llu", header, hist_percentile(h, 50));
+      printf("\n%s_DELAY_P90   \t\t : %10llu", header, hist_percentile(h, 90));
+      printf("\n%s_DELAY_P99   \t\t : %10llu", header, hist_percentile(h, 99));
+      printf("\n%s_DELAY_P99_9 \t\t : %10llu", header, hist_percentile(h, 99.9));
+      printf("\n%s_DELAY_MAX   \t\t : %10llu", header, h->max);
+    }
+  }
+  printf("\n");
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Read and write misses so far, 0 for a cache that is not there
+////////////////////////////////////////////////////////////////////
+
+uns64 memsys_miss_count(Cache *c)
+{
+  return c ? (c->stat_read_miss + c->stat_write_miss) : 0;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Every victim cache hit is an L2 read that did not happen
+////////////////////////////////////////////////////////////////////
+
+void memsys_print_vcache_stats(Cache *vcache, char *header)
+{
+  cache_print_stats(vcache, header);
+  printf("\n%s_L2_ACCESS_SAVED \t\t : %10llu", header, vcache->stat_read_access - vcache->stat_read_miss);
+  printf("\n");
+}
+
 ////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////
 
@@ -261,23 +511,8 @@ uns64 memsys_access_modeBC(Memsys *sys, Addr lineaddr, Access_Type type,uns core
 
     if(outcome_L1 == MISS) { // L1 cache miss
       // We are following 'non-inclusive' policy here.
-      // read from L2
-      // compensation for delay
-      delay +=memsys_L2_access(sys, lineaddr, 0/*is_dirty*/, core_id); // because it is write back cache.
-                                                                       // we will only write back on dirty
-                                                                       // eviction 
-      // cache_install() function takes care of eviction_stat
-      cache_install(sys->dcache, lineaddr, is_dirty, core_id);
-      // if the evicted line is not dirty.. we do not put it in L2
-      if(sys->dcache->last_evicted_line.dirty && 
-         sys->dcache->last_evicted_line.valid) {
-        sys->dcache->last_evicted_line.dirty = FALSE;
-        sys->dcache->last_evicted_line.valid = FALSE;
-        Addr evit_L1_addr = sys->dcache->last_evicted_line.tag;
-        // we are writing back the evicted line to L2 which are 'Dirty': Write-back   
-        memsys_L2_access(sys, evit_L1_addr, 1, core_id); 
-      }
-     
+      // read from the victim cache or L2, install, and write back the dirty victim
+      delay += memsys_dcache_fill(sys, sys->dcache, sys->vcache, sys->wbb, lineaddr, is_dirty, core_id);
     }
   }
 
@@ -285,6 +520,178 @@ uns64 memsys_access_modeBC(Memsys *sys, Addr lineaddr, Access_Type type,uns core
   return delay;
 }
 
+/////////////////////////////////////////////////////////////////////
+// DCACHE miss handling shared by all modes. With a victim cache the
+// line is looked for there first; a hit swaps it back into the DCACHE
+// without touching L2. Every DCACHE victim (clean or dirty) then goes
+// into the victim cache, and whatever falls out of the victim cache,
+// or out of the DCACHE if there is none, is written back if dirty:
+// through the writeback buffer when there is one, else straight to L2.
+// A line still waiting in the writeback buffer is forwarded from it;
+// the buffered copy stays there and goes to L2 as planned.
+/////////////////////////////////////////////////////////////////////
+
+uns64 memsys_dcache_fill(Memsys *sys, Cache *dcache, Cache *vcache, WBB *wbb, Addr lineaddr, Flag is_write, uns core_id){
+  uns64 delay = 0;
+  Flag  vc_dirty = FALSE;
+  Flag  multicore = (SIM_MODE >= SIM_MODE_D);
+
+  if(vcache && (cache_access(vcache, lineaddr, 0, core_id) == HIT)){
+    cache_invalidate(vcache, lineaddr, core_id, &vc_dirty);
+    delay = VCACHE_HIT_LATENCY;
+  } else if(wbb && (wbb_lookup(wbb, lineaddr) == HIT)){
+    wbb->stat_forward++;
+    delay = WBB_HIT_LATENCY;
+  } else if(multicore){
+    delay = memsys_L2_access_multicore(sys, lineaddr, 0, core_id);
+  } else {
+    delay = memsys_L2_access(sys, lineaddr, 0, core_id);
+  }
+
+  // cache_install() function takes care of eviction_stat
+  cache_install(dcache, lineaddr, is_write || vc_dirty, core_id);
+
+  Cache_Line victim = dcache->last_evicted_line;
+  dcache->last_evicted_line.dirty = FALSE;
+  dcache->last_evicted_line.valid = FALSE;
+
+  if(vcache && victim.valid){
+    cache_install(vcache, victim.tag, victim.dirty, core_id);
+    victim = vcache->last_evicted_line;
+    vcache->last_evicted_line.dirty = FALSE;
+    vcache->last_evicted_line.valid = FALSE;
+  }
+
+  // if the evicted line is not dirty.. we do not put it in L2
+  if(victim.valid && victim.dirty){
+    // we are writing back the evicted line to L2 which are 'Dirty': Write-back   
+    if(wbb){
+      delay += memsys_wbb_writeback(sys, wbb, victim.tag, core_id, cycle + delay);
+    } else {
+      memsys_l2_writeback(sys, victim.tag, core_id);
+    }
+  }
+
+  return delay;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Write a dirty line into L2; returns how long the L2 is busy with it
+/////////////////////////////////////////////////////////////////////
+
+uns64 memsys_l2_writeback(Memsys *sys, Addr lineaddr, uns core_id){
+  if(SIM_MODE >= SIM_MODE_D){
+    return memsys_L2_access_multicore(sys, lineaddr, 1, core_id);
+  }
+  return memsys_L2_access(sys, lineaddr, 1, core_id);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Writeback buffer of core_id's DCACHE, NULL if there is none
+/////////////////////////////////////////////////////////////////////
+
+WBB *memsys_wbb(Memsys *sys, uns core_id){
+  if(SIM_MODE >= SIM_MODE_D){
+    return sys->wbb_coreid[core_id];
+  }
+  return sys->wbb;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Write buffered lines into L2 one after another, each once the L2 is
+// done with the previous one, for as long as that fits before now.
+// Demand reads are not held up by these writes.
+/////////////////////////////////////////////////////////////////////
+
+void memsys_wbb_drain(Memsys *sys, WBB *wbb, uns core_id){
+  while(wbb->count && (wbb->drain_cycle <= cycle)){
+    Addr lineaddr = wbb_pop(wbb);
+    wbb->drain_cycle += memsys_l2_writeback(sys, lineaddr, core_id);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Write everything core_id still has buffered into L2, whether or not
+// the L2 would have had time for it yet: used when the core finishes
+// and before stats are printed, so no dirty line is left uncounted.
+/////////////////////////////////////////////////////////////////////
+
+void memsys_wbb_flush(Memsys *sys, uns core_id){
+  WBB *wbb = memsys_wbb(sys, core_id);
+
+  while(wbb && wbb->count){
+    Addr lineaddr = wbb_pop(wbb);
+    wbb->drain_cycle += memsys_l2_writeback(sys, lineaddr, core_id);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Hand a dirty DCACHE victim to the writeback buffer at ready_cycle.
+// A full buffer first writes its oldest line into L2, and the access
+// waits for that; the wait is returned (and kept for stores, whose
+// delay the core otherwise ignores).
+/////////////////////////////////////////////////////////////////////
+
+uns64 memsys_wbb_writeback(Memsys *sys, WBB *wbb, Addr lineaddr, uns core_id, uns64 ready_cycle){
+  uns64 stall = 0;
+
+  if((wbb_lookup(wbb, lineaddr) == MISS) && wbb_full(wbb)){
+    uns64 start = (wbb->drain_cycle > ready_cycle) ? wbb->drain_cycle : ready_cycle;
+    Addr  oldest = wbb_pop(wbb);
+    wbb->drain_cycle = start + memsys_l2_writeback(sys, oldest, core_id);
+    stall = wbb->drain_cycle - ready_cycle;
+
+    wbb->stat_full++;
+    wbb->stat_stall_cycles += stall;
+    wbb->stall_cycles += stall;
+  }
+
+  wbb_insert(wbb, lineaddr, ready_cycle + stall);
+  return stall;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Full-buffer wait of core_id's last access (0 without a buffer)
+/////////////////////////////////////////////////////////////////////
+
+uns64 memsys_wbb_store_stall(Memsys *sys, uns core_id){
+  WBB *wbb = memsys_wbb(sys, core_id);
+  return wbb ? wbb->stall_cycles : 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Would a load of addr hit in core_id's DCACHE? Looks only, so the
+// core can hold a miss until it has an MSHR before sending it. Part A
+// has no timing and always answers HIT.
+/////////////////////////////////////////////////////////////////////
+
+Flag memsys_load_hits(Memsys *sys, Addr addr, uns core_id){
+  Addr lineaddr = addr/CACHE_LINESIZE;
+
+  if(SIM_MODE==SIM_MODE_A){
+    return HIT;
+  }
+  if(SIM_MODE < SIM_MODE_D){
+    return cache_probe(sys->dcache, lineaddr, core_id);
+  }
+
+  uns64 lines_per_page = PAGE_SIZE/CACHE_LINESIZE;
+  uns64 pfn = memsys_convert_vpn_to_pfn(sys, lineaddr/lines_per_page, core_id);
+  return cache_probe(sys->dcache_coreid[core_id], pfn*lines_per_page + lineaddr%lines_per_page, core_id);
+}
+
+////////////////////////////////////////////////////////////////////
+// Every L2 miss and dirty L2 eviction comes through here
+////////////////////////////////////////////////////////////////////
+
+uns64   memsys_mem_access(Memsys *sys, Addr lineaddr, Flag is_write){
+  sys->mem_read_count += !is_write;
+  if(sys->mcache){
+    return mcache_access(sys->mcache, lineaddr, is_write);
+  }
+  return dram_access(sys->dram, lineaddr, is_write);
+}
+
 uns64   memsys_L2_access(Memsys *sys, Addr lineaddr, Flag is_writeback, uns core_id){
 
 
@@ -303,7 +710,7 @@ uns64   memsys_L2_access(Memsys *sys, Addr lineaddr, Flag is_writeback, uns core
 
       // Delay for DRAM access
       // Reading the cache-line from DRAM (Get the line from DRAM)
-      delay += dram_access(sys->dram, lineaddr, 0); 
+      delay += memsys_mem_access(sys, lineaddr, 0); 
       // cache_install() takes care of eviction stat 
       cache_install(sys->l2cache, lineaddr, 0, core_id); // Install the line into L2.. it is not dirty
       // If the evicted line is dirty you need to write it to DRAM, otherwise no action required
@@ -314,7 +721,7 @@ uns64   memsys_L2_access(Memsys *sys, Addr lineaddr, Flag is_writeback, uns core
           sys->l2cache->last_evicted_line.valid = FALSE;
           Addr evit_L2_addr = sys->l2cache->last_evicted_line.tag;
 
-          dram_access(sys->dram, evit_L2_addr, 1/*is_writeback*/);   
+          memsys_mem_access(sys, evit_L2_addr, 1/*is_writeback*/);   
       }
     }
   }
@@ -326,7 +733,7 @@ uns64   memsys_L2_access(Memsys *sys, Addr lineaddr, Flag is_writeback, uns core
                                                                   // from L2 would take place
     if (outcome_L2 == MISS) { // But if there's miss
       // Get the line from DRAM
-      delay += dram_access(sys->dram, lineaddr, 0);
+      delay += memsys_mem_access(sys, lineaddr, 0);
       // This is correct. Evicted entry is dirty.. it needs to write into L2 after
       // getting the stale-line from DRAM.
       // This is the case of 'Write-Allocate' & 'Write-Back'.
@@ -341,7 +748,7 @@ uns64   memsys_L2_access(Memsys *sys, Addr lineaddr, Flag is_writeback, uns core
           Addr evit_L2_addr = sys->l2cache->last_evicted_line.tag;
           //  since line is dirty, put 'is_writeback' true
           is_writeback = TRUE;
-          dram_access(sys->dram, evit_L2_addr, 1/*is_writeback*/);      
+          memsys_mem_access(sys, evit_L2_addr, 1/*is_writeback*/);      
       }
     }
   }
@@ -358,7 +765,7 @@ uns64 memsys_convert_vpn_to_pfn(Memsys *sys, uns64 vpn, uns core_id){
   uns64 tail = vpn & 0x000fffff;
   uns64 head = vpn >> 20;
   uns64 pfn  = tail + (core_id << 21) + (head << 21);
-  assert(NUM_CORES==2);
+  assert(NUM_CORES<=MAX_CORES);
   return pfn;
 }
 
@@ -366,165 +773,114 @@ uns64 memsys_convert_vpn_to_pfn(Memsys *sys, uns64 vpn, uns core_id){
 // --------------- DO NOT CHANGE THE CODE ABOVE THIS LINE ----------
 ////////////////////////////////////////////////////////////////////
 
+/////////////////////////////////////////////////////////////////////
+// Translate v_lineaddr to a physical lineaddr (4KB pages). Without a
+// TLB the translation is free; with one, an L1/L2 TLB miss walks the
+// page table and the walk's PTE loads are charged to this access.
+/////////////////////////////////////////////////////////////////////
+
+uns64 memsys_translate(Memsys *sys, Addr v_lineaddr, Access_Type type, uns core_id, Addr *p_lineaddr){
+  uns64 delay = 0;
+  uns64 lines_per_page = PAGE_SIZE/CACHE_LINESIZE;
+  uns64 vpn = v_lineaddr / lines_per_page;
+  uns64 pfn = memsys_convert_vpn_to_pfn(sys, vpn, core_id);
+  TLB  *tlb = sys->tlb_coreid[core_id];
+
+  if(tlb){
+    Flag outcome_tlb = MISS;
+    delay = tlb_lookup(tlb, vpn, type, &outcome_tlb);
+    if(outcome_tlb == MISS){
+      delay += memsys_page_walk(sys, tlb, vpn, core_id);
+      tlb_install(tlb, vpn, type);
+    }
+  }
+
+  *p_lineaddr = (pfn * lines_per_page) + (v_lineaddr % lines_per_page);
+  return delay;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Hardware page walker: one dependent PTE load per level, issued to
+// the core's DCACHE like any other load (and to L2/DRAM on a miss).
+/////////////////////////////////////////////////////////////////////
+
+uns64 memsys_page_walk(Memsys *sys, TLB *tlb, uns64 vpn, uns core_id){
+  uns64 delay = 0;
+  Cache *dcache = sys->dcache_coreid[core_id];
+
+  for(uns level=0; level<tlb_walk_levels(tlb); level++){
+    Addr pte_lineaddr = tlb_pte_lineaddr(tlb, vpn, level);
+
+    delay += DCACHE_HIT_LATENCY;
+    if(cache_access(dcache, pte_lineaddr, 0, core_id) == MISS){
+      delay += memsys_dcache_fill(sys, dcache, sys->vcache_coreid[core_id], sys->wbb_coreid[core_id], pte_lineaddr, 0, core_id);
+    }
+    tlb->stat_walk_pte_access++;
+  }
+
+  tlb->stat_walks++;
+  tlb->stat_walk_delay += delay;
+  return delay;
+}
+
 /////////////////////////////////////////////////////////////////////
 // For Mode D/E you will use per-core ICACHE and DCACHE
 // ----- YOU NEED TO WRITE THIS FUNCTION AND UPDATE DELAY ----------
 /////////////////////////////////////////////////////////////////////
 
 uns64 memsys_access_modeDE(Memsys *sys, Addr v_lineaddr, Access_Type type,uns core_id){
-  // printf(" At memsys.cpp::memsys_access_modeDE: %d Instn Type: %d core_id: %d\n", __LINE__, type, core_id);
   uns64 delay = 0;
-  uns64 delay_c0=0;
-  uns64 delay_c1=0;
-  Addr p_lineaddr=0;
-  Flag outcome_L1 = FALSE;
-  Addr c0p_lineaddr, c1p_lineaddr;
-  Flag needs_dcache_access_c0 = FALSE;  
-  Flag needs_dcache_access_c1 = FALSE;  
-  Flag is_write_c0 = FALSE;
-  Flag is_write_c1 = FALSE;
-	
-  p_lineaddr = v_lineaddr;
-  
-  // TODO: First convert lineaddr from virtual (v) to physical (p) using the
-  // function memsys_convert_vpn_to_pfn. Page size is defined to be 4KB.
-  // NOTE: VPN_to_PFN operates at page granularity and returns page addr
+  Addr p_lineaddr = 0;
+  Flag outcome_L1 = MISS;
+  Flag needs_dcache_access = FALSE;
+  Flag is_write = FALSE;
+  Cache *icache = sys->icache_coreid[core_id];
+  Cache *dcache = sys->dcache_coreid[core_id];
 
-  if (core_id == 0) { 
-    Addr c0_vpn = v_lineaddr >> 12;
-    Addr c0_pfn = memsys_convert_vpn_to_pfn(sys, c0_vpn, core_id);
-    c0p_lineaddr = (c0_pfn << 12) | (0x00000fff & v_lineaddr);
-    // printf("@cycle: %ld \t v_lineaddr: 0x%lx \t c0_vpn: 0x%lx \t c0_pfn: 0x%lx \t c0p_lineaddr: 0x%lx \n", 
-      // cycle, v_lineaddr, c0_vpn, c0_pfn, c0p_lineaddr); 
-  }
+  assert(core_id < NUM_CORES);
 
-  if (core_id == 1) { 
-    Addr c1_vpn = v_lineaddr >> 12;
-    Addr c1_pfn = memsys_convert_vpn_to_pfn(sys, c1_vpn, core_id);
-    c1p_lineaddr = c1_pfn << 12 | (0x00000fff & v_lineaddr);
-    // printf("@cycle: %ld \t v_lineaddr: 0x%lx \t c1_vpn: 0x%lx \t c1_pfn: 0x%lx \t c1p_lineaddr: 0x%lx \n", 
-      // cycle, v_lineaddr, c1_vpn, c1_pfn, c1p_lineaddr); 
-  }
+  // First convert lineaddr from virtual (v) to physical (p). With -tlb 1
+  // this goes through the per-core TLBs and walks the page table on a miss,
+  // and the translation delay is charged to the access.
+  // NOTE: VPN_to_PFN operates at page granularity and returns page addr
+  delay = memsys_translate(sys, v_lineaddr, type, core_id, &p_lineaddr);
 
-  assert(c0p_lineaddr != c1p_lineaddr);
   if(type == ACCESS_TYPE_IFETCH){
-    // YOU NEED TO WRITE THIS PART AND UPDATE DELAY
-    if (core_id == 0) {
-      outcome_L1 = cache_access(sys->icache_coreid[0], c0p_lineaddr, 0, core_id); // core0 reading line form L1 icache
-
-      delay_c0 = ICACHE_HIT_LATENCY; // updated delay for the read of core0
-
-      if (outcome_L1 == MISS) {   // In case there is a miss, we will read from L2
-        // printf("@Cycle: %d \t IFETCH-L1-MISS: core0\n", cycle);
-        delay_c0 += memsys_L2_access_multicore(sys, c0p_lineaddr, 0, core_id); // put the delay of reading it from L2
-        // Install the line in L1, no writeback
-        cache_install(sys->icache_coreid[0], c0p_lineaddr, 0, core_id); // Install the line
-      }
-    }
-    if (core_id == 1) {
-      outcome_L1 = cache_access(sys->icache_coreid[1], c1p_lineaddr, 0, core_id); // Respective core reading line form L1 icache
+    outcome_L1 = cache_access(icache, p_lineaddr, 0, core_id); // Reading line form this core's L1 icache
 
-      delay_c1 = ICACHE_HIT_LATENCY; // updated delay for the read
+    delay += ICACHE_HIT_LATENCY; // updated delay for the read
 
-      if (outcome_L1 == MISS) {   // In case there is a miss, we will read from L2
-        // printf("@Cycle: %d \t IFETCH-L1-MISS: core1\n", cycle);
-        delay_c1 += memsys_L2_access_multicore(sys, c1p_lineaddr, 0, core_id); // put the delay of reading it from L2
-        // Install the line in L1, no writeback
-        cache_install(sys->icache_coreid[1], c1p_lineaddr, 0, core_id); // Install the line
-      }
+    if (outcome_L1 == MISS) {   // In case there is a miss, we will read from L2
+      delay += memsys_L2_access_multicore(sys, p_lineaddr, 0, core_id); // put the delay of reading it from L2
+      // Install the line in L1, no writeback
+      cache_install(icache, p_lineaddr, 0, core_id); // Install the line
     }
   }
 
   if(type == ACCESS_TYPE_LOAD){
-    // YOU NEED TO WRITE THIS PART AND UPDATE DELAY
-    if (core_id == 0) {
-      needs_dcache_access_c0 = TRUE;
-      is_write_c0 = FALSE;
-    }
-    if (core_id == 1) {
-      needs_dcache_access_c1 = TRUE;
-      is_write_c1 = FALSE;
-    }
+    needs_dcache_access = TRUE;
+    is_write = FALSE;
   }
   
   if(type == ACCESS_TYPE_STORE){
-    // YOU NEED TO WRITE THIS PART AND UPDATE DELAY
-    if (core_id == 0) {
-      needs_dcache_access_c0 = TRUE;
-      is_write_c0 = TRUE;
-    }
-    if (core_id == 1) {
-      needs_dcache_access_c1 = TRUE;
-      is_write_c1 = TRUE;
-    }
-  }
-  // Both CPUs can access this code but need to work on 
-  // their own variable and structure
-  if (needs_dcache_access_c0 || needs_dcache_access_c1) { // Both LD/ST would come here
-    if(core_id == 0) {
-      // Accessing L1 dcache(for reading/writing based on 'is_dirty') 
-      outcome_L1 = cache_access(sys->dcache_coreid[0], c0p_lineaddr, is_write_c0, core_id); 
-
-      delay_c0 = DCACHE_HIT_LATENCY; // initialized the delay for DCACHE access
-
-      if(outcome_L1 == MISS) { // L1 cache miss
-        // We are following 'non-inclusive' policy here.
-        // read from L2
-        // compensation for delay
-        // printf("@Cycle: %d \t DCACHE-L1-MISS: core0 type: %d\n", cycle, type);
-        delay_c0 +=memsys_L2_access_multicore(sys, c0p_lineaddr, 0/*is_dirty*/, core_id); // because it is write back cache.
-                                                                         // we will only write back on dirty
-                                                                         // eviction 
-        // cache_install() function takes care of eviction_stat
-        cache_install(sys->dcache_coreid[0], c0p_lineaddr, is_write_c0, core_id);
-        // if the evicted line is not dirty.. we do not put it in L2
-        if(sys->dcache_coreid[0]->last_evicted_line.dirty && 
-           sys->dcache_coreid[0]->last_evicted_line.valid) {
-          sys->dcache_coreid[0]->last_evicted_line.dirty = FALSE;
-          sys->dcache_coreid[0]->last_evicted_line.valid = FALSE;
-          Addr evit_L1_addr = sys->dcache_coreid[0]->last_evicted_line.tag;
-          // we are writing back the evicted line to L2 which are 'Dirty': Write-back   
-          memsys_L2_access_multicore(sys, evit_L1_addr, 1, core_id); 
-        }
-       
-      }      
-    }
-    if(core_id == 1) {
-      // Accessing L1 dcache(for reading/writing based on 'is_dirty') 
-      outcome_L1 = cache_access(sys->dcache_coreid[1], c1p_lineaddr, is_write_c1, core_id); 
-
-      delay_c1 = DCACHE_HIT_LATENCY; // initialized the delay for DCACHE access
-
-      if(outcome_L1 == MISS) { // L1 cache miss
-        // We are following 'non-inclusive' policy here.
-        // read from L2
-        // compensation for delay
-        // printf("@Cycle: %d \t DCACHE-L1-MISS: core1 type: %d\n", cycle, type);
-
-        delay_c1 +=memsys_L2_access_multicore(sys, c1p_lineaddr, 0/*is_dirty*/, core_id); // because it is write back cache.
-                                                                         // we will only write back on dirty
-                                                                         // eviction 
-        // cache_install() function takes care of eviction_stat
-        cache_install(sys->dcache_coreid[1], c1p_lineaddr, is_write_c1, core_id);
-        // if the evicted line is not dirty.. we do not put it in L2
-        if(sys->dcache_coreid[1]->last_evicted_line.dirty && 
-           sys->dcache_coreid[1]->last_evicted_line.valid) {
-          sys->dcache_coreid[1]->last_evicted_line.dirty = FALSE;
-          sys->dcache_coreid[1]->last_evicted_line.valid = FALSE;
-          Addr evit_L1_addr = sys->dcache_coreid[1]->last_evicted_line.tag;
-          // we are writing back the evicted line to L2 which are 'Dirty': Write-back   
-          memsys_L2_access_multicore(sys, evit_L1_addr, 1, core_id); 
-        }
-      }            
-    }
+    needs_dcache_access = TRUE;
+    is_write = TRUE;
   }
 
+  // Every core runs this code on its own private caches
+  if (needs_dcache_access) { // Both LD/ST would come here
+    // Accessing L1 dcache(for reading/writing based on 'is_write') 
+    outcome_L1 = cache_access(dcache, p_lineaddr, is_write, core_id); 
+
+    delay += DCACHE_HIT_LATENCY; // initialized the delay for DCACHE access
 
-  if (core_id == 0) {
-    delay = delay_c0;
-  } else{
-    delay = delay_c1;
+    if(outcome_L1 == MISS) { // L1 cache miss
+      // We are following 'non-inclusive' policy here.
+      // read from the victim cache or L2, install, and write back the dirty victim
+      delay += memsys_dcache_fill(sys, dcache, sys->vcache_coreid[core_id], sys->wbb_coreid[core_id], p_lineaddr, is_write, core_id);
+    }
   }
+
   return delay;
 }
 
@@ -545,6 +901,15 @@ uns64   memsys_L2_access_multicore(Memsys *sys, Addr lineaddr, Flag is_writeback
 
   // printf("@Cycle: %d \t memsys_L2_access_multicore() \t is_writeback: %d \t core_id: %d\n", cycle, is_writeback, core_id);
   if(is_writeback == 0) { //Reading <both for LD/ST> (requesting line in case of store as following WB strategy)
+    // UCP: demand reads train the utility monitor, which repartitions the
+    // L2 ways every UCP_INTERVAL cycles
+    if(sys->umon){
+      umon_access(sys->umon, lineaddr, core_id);
+      if(cycle >= sys->umon->next_partition_cycle){
+        umon_partition(sys->umon, sys->l2cache);
+      }
+    }
+
     // Read request from L1
     outcome_L2 = cache_access(sys->l2cache, lineaddr, 0, core_id); // Reading line from L2 in case of L1 miss
     if (outcome_L2 == MISS) { // If there is L2 miss on read
@@ -552,7 +917,7 @@ uns64   memsys_L2_access_multicore(Memsys *sys, Addr lineaddr, Flag is_writeback
       // Delay for DRAM access
       // Reading the cache-line from DRAM (Get the line from DRAM)
       // printf("L2-MISS, get the line from DRAM\n");
-      delay += dram_access(sys->dram, lineaddr, 0); 
+      delay += memsys_mem_access(sys, lineaddr, 0); 
       // cache_install() takes care of eviction stat 
       // printf("Installing the cache in L2\n");
       cache_install(sys->l2cache, lineaddr, 0, core_id); // Install the line into L2.. it is not dirty
@@ -564,7 +929,7 @@ uns64   memsys_L2_access_multicore(Memsys *sys, Addr lineaddr, Flag is_writeback
           sys->l2cache->last_evicted_line.valid = FALSE;
           Addr evit_L2_addr = sys->l2cache->last_evicted_line.tag;
 
-          dram_access(sys->dram, evit_L2_addr, 1/*is_writeback*/);   
+          memsys_mem_access(sys, evit_L2_addr, 1/*is_writeback*/);   
       }
     }
   }
@@ -577,7 +942,7 @@ uns64   memsys_L2_access_multicore(Memsys *sys, Addr lineaddr, Flag is_writeback
     if (outcome_L2 == MISS) { // But if there's miss
       // printf("L2-MISS, get the line from DRAM\n");
       // Get the line from DRAM
-      delay += dram_access(sys->dram, lineaddr, 0);
+      delay += memsys_mem_access(sys, lineaddr, 0);
       // This is correct. Evicted entry is dirty.. it needs to write into L2 after
       // getting the stale-line from DRAM.
       // This is the case of 'Write-Allocate' & 'Write-Back'.
@@ -593,7 +958,7 @@ uns64   memsys_L2_access_multicore(Memsys *sys, Addr lineaddr, Flag is_writeback
           Addr evit_L2_addr = sys->l2cache->last_evicted_line.tag;
           //  since line is dirty, put 'is_writeback' true
           is_writeback = TRUE;
-          dram_access(sys->dram, evit_L2_addr, 1/*is_writeback*/);      
+          memsys_mem_access(sys, evit_L2_addr, 1/*is_writeback*/);      
       }
     }
   }
@@ -4,6 +4,15 @@
 #include "types.h"
 #include "cache.h"
 #include "dram.h"
+#include "tlb.h"
+#include "umon.h"
+#include "cat.h"
+#include "wbb.h"
+#include "mcache.h"
+#include "hist.h"
+#include "pcprof.h"
+
+#define NUM_ACCESS_TYPES 3  // ifetch, load, store
 
 //////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////
@@ -13,13 +22,20 @@ typedef struct Memsys   Memsys;
 struct Memsys {
   Cache *dcache;  // For Part A
   Cache *icache;  // For Part A,B,C
-
-  Cache *dcache_coreid[MAX_CORES];  // For Part D,E
-  Cache *icache_coreid[MAX_CORES];  // For Part D,E
-  Cache *umon_coreid[MAX_CORES];    // For Part F
+  Cache *vcache;  // For Part B,C (victim cache behind dcache, -VCentries)
+  WBB   *wbb;     // For Part B,C (writeback buffer behind dcache, -WBBentries)
+
+  Cache *dcache_coreid[MAX_CORES];  // For Part D,E,F
+  Cache *icache_coreid[MAX_CORES];  // For Part D,E,F
+  Cache *vcache_coreid[MAX_CORES];  // For Part D,E,F (victim cache behind dcache)
+  WBB   *wbb_coreid[MAX_CORES];     // For Part D,E,F (writeback buffer behind dcache)
+  TLB   *tlb_coreid[MAX_CORES];     // For Part D,E,F (with -tlb 1)
+  UMON  *umon;                      // For Part F (L2 repl UCP)
+  uns64  cat_next_cycle;            // next scheduled L2 way-mask change
   
   Cache *l2cache; // For Part A,B,C,D,E
   DRAM  *dram;    // For Part C,D,E
+  MCache *mcache; // For Part C,D,E (DRAM cache in front of dram, -MCsizeMB)
 
    // stats 
   uns64 stat_ifetch_access;
@@ -28,6 +44,10 @@ struct Memsys {
   uns64 stat_ifetch_delay;
   uns64 stat_load_delay;
   uns64 stat_store_delay;
+  Hist  stat_delay_hist[MAX_CORES][NUM_ACCESS_TYPES]; // with -lathist 1
+
+  PC_Prof *pcprof;       // per-PC miss profile (-pcprof)
+  uns64  mem_read_count; // reads below the L2, for the profile
 };
 
 
@@ -36,11 +56,13 @@ struct Memsys {
 ///////////////////////////////////////////////////////////////////
 
 Memsys *memsys_new();
+void    memsys_init_l2_partition(Memsys *sys);
 void    memsys_print_stats(Memsys *sys);
+void    memsys_print_vcache_stats(Cache *vcache, char *header);
+void    memsys_print_delay_hist(Memsys *sys);
+uns64   memsys_miss_count(Cache *c);
 
-int    trigger_partition();
-
-uns64   memsys_access(Memsys *sys, Addr addr, Access_Type type, uns core_id);
+uns64   memsys_access(Memsys *sys, Addr addr, Access_Type type, uns core_id, Addr pc);
 uns64   memsys_access_modeA(Memsys *sys, Addr lineaddr, Access_Type type, uns core_id);
 uns64   memsys_access_modeBC(Memsys *sys, Addr lineaddr, Access_Type type, uns core_id);
 uns64   memsys_access_modeDE(Memsys *sys, Addr lineaddr, Access_Type type, uns core_id);
@@ -50,9 +72,28 @@ uns64   memsys_access_modeDE(Memsys *sys, Addr lineaddr, Access_Type type, uns c
 uns64   memsys_L2_access(Memsys *sys, Addr lineaddr, Flag is_writeback, uns core_id);
 uns64   memsys_L2_access_multicore(Memsys *sys, Addr lineaddr, Flag is_writeback, uns core_id);
 
+// Below the L2: through the DRAM cache when there is one
+uns64   memsys_mem_access(Memsys *sys, Addr lineaddr, Flag is_write);
+
+// DCACHE miss path: victim cache (if any), L2, install and writeback
+uns64   memsys_dcache_fill(Memsys *sys, Cache *dcache, Cache *vcache, WBB *wbb, Addr lineaddr, Flag is_write, uns core_id);
+uns64   memsys_l2_writeback(Memsys *sys, Addr lineaddr, uns core_id);
+
+// Writeback buffer between DCACHE and L2 (-WBBentries)
+WBB    *memsys_wbb(Memsys *sys, uns core_id);
+void    memsys_wbb_drain(Memsys *sys, WBB *wbb, uns core_id);
+void    memsys_wbb_flush(Memsys *sys, uns core_id);
+uns64   memsys_wbb_writeback(Memsys *sys, WBB *wbb, Addr lineaddr, uns core_id, uns64 ready_cycle);
+uns64   memsys_wbb_store_stall(Memsys *sys, uns core_id);
+Flag    memsys_load_hits(Memsys *sys, Addr addr, uns core_id);
+
 // This function can convert VPN to PFN
 uns64 memsys_convert_vpn_to_pfn(Memsys *sys, uns64 vpn, uns core_id);
 
+// Translate a virtual lineaddr, returns the translation delay (TLB + walk)
+uns64   memsys_translate(Memsys *sys, Addr v_lineaddr, Access_Type type, uns core_id, Addr *p_lineaddr);
+uns64   memsys_page_walk(Memsys *sys, TLB *tlb, uns64 vpn, uns core_id);
+
 ///////////////////////////////////////////////////////////////////
 
 #endif // MEMSYS_H
@@ -0,0 +1,210 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "missclass.h"
+
+#define MISSCLASS_NONE    ((uns)(-1))
+#define MISSCLASS_HASH    0x9E3779B97F4A7C15ULL
+
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+static uns64 missclass_pow2(uns64 n){
+  uns64 size = 16;
+  while(size < n){
+    size <<= 1;
+  }
+  return size;
+}
+
+Miss_Class *missclass_new(uns64 capacity){
+  Miss_Class *mc = (Miss_Class *) calloc (1, sizeof (Miss_Class));
+  assert(capacity && (capacity < MISSCLASS_NONE));
+
+  mc->capacity   = capacity;
+  mc->slot_key   = (uns64 *) calloc (capacity, sizeof(uns64));
+  mc->slot_prev  = (uns *) calloc (capacity, sizeof(uns));
+  mc->slot_next  = (uns *) calloc (capacity, sizeof(uns));
+  mc->head       = MISSCLASS_NONE;
+  mc->tail       = MISSCLASS_NONE;
+
+  // at most half full keeps the probe sequences short
+  mc->table_mask = missclass_pow2(2*capacity) - 1;
+  mc->table      = (uns *) calloc (mc->table_mask+1, sizeof(uns));
+
+  mc->seen_mask  = missclass_pow2(2*capacity) - 1;
+  mc->seen       = (uns64 *) calloc (mc->seen_mask+1, sizeof(uns64));
+
+  return mc;
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+static inline uns64 missclass_hash(uns64 key, uns64 mask){
+  return ((key * MISSCLASS_HASH) >> 20) & mask;
+}
+
+///////////////////////////////////////////////////////////////////
+// Seen set. Returns TRUE if key was already in it, and adds it.
+// Doubles when half full, it only ever grows with the footprint.
+///////////////////////////////////////////////////////////////////
+
+static Flag missclass_seen(Miss_Class *mc, uns64 key){
+  uns64 ii = missclass_hash(key, mc->seen_mask);
+
+  while(mc->seen[ii]){
+    if(mc->seen[ii] == key+1){
+      return TRUE;
+    }
+    ii = (ii+1) & mc->seen_mask;
+  }
+  mc->seen[ii] = key+1;
+  mc->seen_count++;
+
+  if(2*mc->seen_count > mc->seen_mask){
+    uns64  old_mask = mc->seen_mask;
+    uns64 *old      = mc->seen;
+    mc->seen_mask   = 2*old_mask + 1;
+    mc->seen        = (uns64 *) calloc (mc->seen_mask+1, sizeof(uns64));
+    for(uns64 jj=0; jj<=old_mask; jj++){
+      if(old[jj]){
+        uns64 kk = missclass_hash(old[jj]-1, mc->seen_mask);
+        while(mc->seen[kk]){
+          kk = (kk+1) & mc->seen_mask;
+        }
+        mc->seen[kk] = old[jj];
+      }
+    }
+    free(old);
+  }
+  return FALSE;
+}
+
+///////////////////////////////////////////////////////////////////
+// LRU shadow: table position holding key, or the empty position
+// where it would go
+///////////////////////////////////////////////////////////////////
+
+static uns64 missclass_find(Miss_Class *mc, uns64 key){
+  uns64 ii = missclass_hash(key, mc->table_mask);
+
+  while(mc->table[ii] && (mc->slot_key[mc->table[ii]-1] != key)){
+    ii = (ii+1) & mc->table_mask;
+  }
+  return ii;
+}
+
+// Backward-shift delete, so lookups never need tombstones
+static void missclass_remove(Miss_Class *mc, uns64 ii){
+  uns64 jj = ii;
+
+  while(TRUE){
+    jj = (jj+1) & mc->table_mask;
+    if(mc->table[jj] == 0){
+      break;
+    }
+    uns64 home = missclass_hash(mc->slot_key[mc->table[jj]-1], mc->table_mask);
+    // the entry at jj can fill the hole unless its home is in (ii, jj]
+    if(((jj - home) & mc->table_mask) >= ((jj - ii) & mc->table_mask)){
+      mc->table[ii] = mc->table[jj];
+      ii = jj;
+    }
+  }
+  mc->table[ii] = 0;
+}
+
+static void missclass_unlink(Miss_Class *mc, uns slot){
+  uns prev = mc->slot_prev[slot], next = mc->slot_next[slot];
+
+  if(prev != MISSCLASS_NONE){
+    mc->slot_next[prev] = next;
+  } else {
+    mc->head = next;
+  }
+  if(next != MISSCLASS_NONE){
+    mc->slot_prev[next] = prev;
+  } else {
+    mc->tail = prev;
+  }
+}
+
+static void missclass_push_mru(Miss_Class *mc, uns slot){
+  mc->slot_prev[slot] = MISSCLASS_NONE;
+  mc->slot_next[slot] = mc->head;
+  if(mc->head != MISSCLASS_NONE){
+    mc->slot_prev[mc->head] = slot;
+  } else {
+    mc->tail = slot;
+  }
+  mc->head = slot;
+}
+
+// Returns HIT if the fully associative shadow holds key; either way
+// key ends up MRU
+static Flag missclass_lru_access(Miss_Class *mc, uns64 key){
+  uns64 ii = missclass_find(mc, key);
+  uns   slot;
+
+  if(mc->table[ii]){
+    slot = mc->table[ii]-1;
+    missclass_unlink(mc, slot);
+    missclass_push_mru(mc, slot);
+    return HIT;
+  }
+
+  if(mc->count < mc->capacity){
+    slot = mc->count++;
+  } else {
+    slot = mc->tail;
+    missclass_unlink(mc, slot);
+    missclass_remove(mc, missclass_find(mc, mc->slot_key[slot]));
+    ii = missclass_find(mc, key); // the delete may have moved the hole
+  }
+
+  mc->slot_key[slot] = key;
+  mc->table[ii]      = slot+1;
+  missclass_push_mru(mc, slot);
+  return MISS;
+}
+
+///////////////////////////////////////////////////////////////////
+// Called with the cache's outcome for every access; the shadows see
+// hits as well, to keep their recency in step with the cache
+///////////////////////////////////////////////////////////////////
+
+void    missclass_access(Miss_Class *mc, Addr lineaddr, uns core_id, Flag outcome){
+  uns64 key       = (lineaddr << 4) | core_id; // MAX_CORES
+  Flag  seen      = missclass_seen(mc, key);
+  Flag  fa_outcome = missclass_lru_access(mc, key);
+
+  if(outcome == HIT){
+    return;
+  }
+
+  if(!seen){
+    mc->stat_compulsory++;
+  } else if(fa_outcome == MISS){
+    mc->stat_capacity++;
+  } else {
+    mc->stat_conflict++;
+  }
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+void    missclass_print_stats(Miss_Class *mc, char *header){
+  uns64  misses = mc->stat_compulsory + mc->stat_capacity + mc->stat_conflict;
+  double denom  = misses ? (double)(misses) : 1;
+
+  printf("\n%s_MISS_COMPULSORY\t\t : %10llu", header, mc->stat_compulsory);
+  printf("\n%s_MISS_CAPACITY  \t\t : %10llu", header, mc->stat_capacity);
+  printf("\n%s_MISS_CONFLICT  \t\t : %10llu", header, mc->stat_conflict);
+  printf("\n%s_COMPULSORY_PERC\t\t : %10.3f", header, 100*(double)(mc->stat_compulsory)/denom);
+  printf("\n%s_CAPACITY_PERC  \t\t : %10.3f", header, 100*(double)(mc->stat_capacity)/denom);
+  printf("\n%s_CONFLICT_PERC  \t\t : %10.3f", header, 100*(double)(mc->stat_conflict)/denom);
+}
@@ -0,0 +1,57 @@
+#ifndef MISSCLASS_H
+#define MISSCLASS_H
+
+#include "types.h"
+
+typedef struct Miss_Class Miss_Class;
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+// Three-C miss classification (Hill, 1987) for one cache. Next to
+// the cache run two shadows fed with the same accesses:
+//  - every line ever touched, in a hash set: a miss on a line never
+//    seen before is compulsory;
+//  - a fully associative LRU cache of the same capacity: a miss that
+//    would also miss there is a capacity miss, the rest are conflict
+//    misses, i.e. what more associativity would buy back.
+// The LRU shadow is a hash table into a doubly linked recency list,
+// so every access is O(1) no matter the cache size. Lines are keyed
+// with their core_id, the same way the cache matches them.
+
+struct Miss_Class {
+  uns64  capacity;     // lines
+  uns64  count;
+
+  // LRU shadow: slots linked in recency order, head is MRU
+  uns64 *slot_key;
+  uns   *slot_prev;
+  uns   *slot_next;
+  uns    head;
+  uns    tail;
+  uns   *table;        // open addressing, slot+1 (0 is empty)
+  uns64  table_mask;
+
+  // lines seen so far, open addressing, key+1 (0 is empty)
+  uns64 *seen;
+  uns64  seen_mask;
+  uns64  seen_count;
+
+  // stats
+  uns64  stat_compulsory;
+  uns64  stat_capacity;
+  uns64  stat_conflict;
+};
+
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Miss_Class *missclass_new(uns64 capacity);
+void    missclass_access(Miss_Class *mc, Addr lineaddr, uns core_id, Flag outcome);
+void    missclass_print_stats(Miss_Class *mc, char *header);
+
+
+
+#endif // MISSCLASS_H
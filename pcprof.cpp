@@ -0,0 +1,118 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcprof.h"
+
+#define PCPROF_INIT_SIZE  4096
+#define PCPROF_HASH       0x9E3779B97F4A7C15ULL
+
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+PC_Prof *pcprof_new(uns top_n){
+  PC_Prof *prof = (PC_Prof *) calloc (1, sizeof (PC_Prof));
+  prof->top_n = top_n;
+  prof->mask  = PCPROF_INIT_SIZE-1;
+  prof->table = (PC_Prof_Entry *) calloc (PCPROF_INIT_SIZE, sizeof(PC_Prof_Entry));
+  return prof;
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+static inline uns64 pcprof_hash(Addr pc, uns core_id, uns64 mask){
+  return (((pc << 4) ^ core_id) * PCPROF_HASH >> 24) & mask;
+}
+
+static PC_Prof_Entry *pcprof_find(PC_Prof_Entry *table, uns64 mask, Addr pc, uns core_id){
+  uns64 ii = pcprof_hash(pc, core_id, mask);
+
+  while(table[ii].valid && ((table[ii].pc != pc) || (table[ii].core_id != core_id))){
+    ii = (ii+1) & mask;
+  }
+  return &table[ii];
+}
+
+static void pcprof_grow(PC_Prof *prof){
+  PC_Prof_Entry *old = prof->table;
+  uns64 old_mask = prof->mask;
+
+  prof->mask  = 2*old_mask + 1;
+  prof->table = (PC_Prof_Entry *) calloc (prof->mask+1, sizeof(PC_Prof_Entry));
+  for(uns64 ii=0; ii<=old_mask; ii++){
+    if(old[ii].valid){
+      *pcprof_find(prof->table, prof->mask, old[ii].pc, old[ii].core_id) = old[ii];
+    }
+  }
+  free(old);
+}
+
+///////////////////////////////////////////////////////////////////
+// One load/store and what it cost
+///////////////////////////////////////////////////////////////////
+
+void    pcprof_access(PC_Prof *prof, Addr pc, uns core_id, uns64 l1_miss,
+                      uns64 l2_miss, uns64 mem_read, uns64 delay){
+  PC_Prof_Entry *e = pcprof_find(prof->table, prof->mask, pc, core_id);
+
+  if(!e->valid){
+    e->valid   = TRUE;
+    e->pc      = pc;
+    e->core_id = core_id;
+    prof->count++;
+  }
+  e->access++;
+  e->l1_miss  += l1_miss;
+  e->l2_miss  += l2_miss;
+  e->mem_read += mem_read;
+  e->delay    += delay;
+
+  if(2*prof->count > prof->mask){
+    pcprof_grow(prof);
+  }
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+static int pcprof_cmp_delay(const void *a, const void *b){
+  const PC_Prof_Entry *ea = (const PC_Prof_Entry *) a;
+  const PC_Prof_Entry *eb = (const PC_Prof_Entry *) b;
+
+  if(ea->delay != eb->delay){
+    return (ea->delay < eb->delay) ? 1 : -1;
+  }
+  return (ea->pc < eb->pc) ? -1 : (ea->pc > eb->pc);
+}
+
+///////////////////////////////////////////////////////////////////
+// The top_n PCs by total cycles, with their share of all memory
+// cycles. Sorts the table in place, so call it once, at the end.
+///////////////////////////////////////////////////////////////////
+
+void    pcprof_print_stats(PC_Prof *prof, char *header){
+  uns64 used = 0, total_delay = 0;
+
+  for(uns64 ii=0; ii<=prof->mask; ii++){
+    if(prof->table[ii].valid){
+      total_delay += prof->table[ii].delay;
+      prof->table[used++] = prof->table[ii];
+    }
+  }
+  qsort(prof->table, used, sizeof(PC_Prof_Entry), pcprof_cmp_delay);
+
+  printf("\n%s_PCS            \t\t : %10llu", header, used);
+  printf("\n%s  rank core         pc     access   l1d_miss    l2_miss   mem_read    avg_delay  delay_perc",
+         header);
+  for(uns64 ii=0; (ii<used) && (ii<prof->top_n); ii++){
+    PC_Prof_Entry *e = &prof->table[ii];
+    printf("\n%s  %4llu %4u 0x%08llx %10llu %10llu %10llu %10llu %12.3f %11.3f", header, ii+1,
+           e->core_id, e->pc, e->access, e->l1_miss, e->l2_miss, e->mem_read,
+           (double)(e->delay)/(double)(e->access),
+           total_delay ? 100*(double)(e->delay)/(double)(total_delay) : 0);
+  }
+  printf("\n");
+}
@@ -0,0 +1,49 @@
+#ifndef PCPROF_H
+#define PCPROF_H
+
+#include "types.h"
+
+typedef struct PC_Prof       PC_Prof;
+typedef struct PC_Prof_Entry PC_Prof_Entry;
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+// Per-instruction miss profile: for every load/store PC, how often it
+// missed in the DCACHE, the L2 and went to memory, and the cycles its
+// accesses took. Misses are charged to the access that caused them,
+// including the L2 misses of the dirty DCACHE victim it pushed out.
+// Entries live in an open-addressing table keyed by (core, PC) that
+// doubles when half full.
+
+struct PC_Prof_Entry {
+  Addr  pc;
+  uns   core_id;
+  Flag  valid;
+  uns64 access;
+  uns64 l1_miss;
+  uns64 l2_miss;
+  uns64 mem_read;
+  uns64 delay;
+};
+
+struct PC_Prof {
+  PC_Prof_Entry *table;
+  uns64 mask;
+  uns64 count;
+  uns   top_n;         // entries printed, by total delay
+};
+
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+PC_Prof *pcprof_new(uns top_n);
+void    pcprof_access(PC_Prof *prof, Addr pc, uns core_id, uns64 l1_miss,
+                      uns64 l2_miss, uns64 mem_read, uns64 delay);
+void    pcprof_print_stats(PC_Prof *prof, char *header);
+
+
+
+#endif // PCPROF_H
@@ -0,0 +1,275 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reuse.h"
+
+#define REUSE_HASH          0x9E3779B97F4A7C15ULL
+#define REUSE_SAMPLE_HASH   0xC2B2AE3D27D4EB4FULL
+#define REUSE_INIT_SIZE     4096
+#define REUSE_MRC_MIN_KB    16
+#define REUSE_MRC_MAX_KB    (64*1024)
+
+extern uns64  CACHE_LINESIZE;
+extern uns64  REUSE_SAMPLE_RATE;
+extern uns64  REUSE_WINDOW;
+
+static const char *reuse_class_name[REUSE_CLASSES] = {"IFETCH", "LOAD", "STORE", "ALL"};
+
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+Reuse_Prof *reuse_new(uns core_id, FILE *ws_fp){
+  Reuse_Prof *rp = (Reuse_Prof *) calloc (1, sizeof (Reuse_Prof));
+  rp->core_id     = core_id;
+  rp->sample_rate = REUSE_SAMPLE_RATE ? REUSE_SAMPLE_RATE : 1;
+  rp->window_size = REUSE_WINDOW;
+  rp->ws_fp       = ws_fp;
+
+  rp->table_mask  = REUSE_INIT_SIZE-1;
+  rp->table       = (Reuse_Entry *) calloc (REUSE_INIT_SIZE, sizeof(Reuse_Entry));
+  rp->tree_size   = REUSE_INIT_SIZE;
+  rp->tree        = (uns *) calloc (rp->tree_size+1, sizeof(uns));
+
+  return rp;
+}
+
+///////////////////////////////////////////////////////////////////
+// Fenwick tree, 1-based inside: position t lives at tree[t+1]
+///////////////////////////////////////////////////////////////////
+
+static inline void reuse_tree_add(Reuse_Prof *rp, uns64 t, int delta){
+  for(uns64 ii=t+1; ii<=rp->tree_size; ii+=ii&(~ii+1)){
+    rp->tree[ii] += delta;
+  }
+}
+
+// marks at timestamps [0, t)
+static inline uns64 reuse_tree_prefix(Reuse_Prof *rp, uns64 t){
+  uns64 sum = 0;
+  for(uns64 ii=t; ii>0; ii-=ii&(~ii+1)){
+    sum += rp->tree[ii];
+  }
+  return sum;
+}
+
+///////////////////////////////////////////////////////////////////
+// Out of timestamps: renumber the live lines 0..n-1 in the order of
+// their latest access and rebuild the tree, at least half empty
+///////////////////////////////////////////////////////////////////
+
+static void reuse_compact(Reuse_Prof *rp){
+  uns64 old_size = rp->tree_size;
+  uns  *rank     = (uns *) calloc (old_size, sizeof(uns));
+  uns64 live     = 0;
+
+  for(uns64 ii=0; ii<=rp->table_mask; ii++){
+    if(rp->table[ii].lineaddr){
+      rank[rp->table[ii].time] = 1;
+    }
+  }
+  for(uns64 tt=0; tt<old_size; tt++){
+    uns present = rank[tt];
+    rank[tt] = live;
+    live += present;
+  }
+  for(uns64 ii=0; ii<=rp->table_mask; ii++){
+    if(rp->table[ii].lineaddr){
+      rp->table[ii].time = rank[rp->table[ii].time];
+    }
+  }
+  free(rank);
+
+  while(rp->tree_size < 2*live){
+    rp->tree_size *= 2;
+  }
+  free(rp->tree);
+  rp->tree = (uns *) calloc (rp->tree_size+1, sizeof(uns));
+
+  // linear-time build with a 1 at each of [0, live): every node,
+  // empty or not, passes its sum on so the upper nodes cover it
+  for(uns64 ii=1; ii<=rp->tree_size; ii++){
+    rp->tree[ii] += (ii <= live);
+    uns64 parent = ii + (ii&(~ii+1));
+    if(parent <= rp->tree_size){
+      rp->tree[parent] += rp->tree[ii];
+    }
+  }
+  assert(reuse_tree_prefix(rp, rp->tree_size) == live);
+  rp->now = live;
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+static Reuse_Entry *reuse_find(Reuse_Entry *table, uns64 mask, Addr lineaddr){
+  uns64 ii = ((lineaddr * REUSE_HASH) >> 24) & mask;
+
+  while(table[ii].lineaddr && (table[ii].lineaddr != lineaddr+1)){
+    ii = (ii+1) & mask;
+  }
+  return &table[ii];
+}
+
+static void reuse_grow(Reuse_Prof *rp){
+  Reuse_Entry *old = rp->table;
+  uns64 old_mask   = rp->table_mask;
+
+  rp->table_mask = 2*old_mask + 1;
+  rp->table      = (Reuse_Entry *) calloc (rp->table_mask+1, sizeof(Reuse_Entry));
+  for(uns64 ii=0; ii<=old_mask; ii++){
+    if(old[ii].lineaddr){
+      *reuse_find(rp->table, rp->table_mask, old[ii].lineaddr-1) = old[ii];
+    }
+  }
+  free(old);
+}
+
+///////////////////////////////////////////////////////////////////
+// Working set of a window: distinct lines per class, scaled
+///////////////////////////////////////////////////////////////////
+
+static void reuse_close_window(Reuse_Prof *rp){
+  if(rp->ws_fp){
+    fprintf(rp->ws_fp, "%u,%llu", rp->core_id, rp->window);
+  }
+  for(uns cc=0; cc<REUSE_CLASSES; cc++){
+    uns64 lines = rp->ws_lines[cc]*rp->sample_rate;
+    rp->stat_ws_sum[cc] += (double)(lines);
+    rp->stat_ws_max[cc]  = (lines > rp->stat_ws_max[cc]) ? lines : rp->stat_ws_max[cc];
+    rp->ws_lines[cc]     = 0;
+    if(rp->ws_fp){
+      fprintf(rp->ws_fp, ",%.1f", (double)(lines*CACHE_LINESIZE)/1024.0);
+    }
+  }
+  if(rp->ws_fp){
+    fprintf(rp->ws_fp, "\n");
+  }
+
+  rp->stat_windows++;
+  rp->window++;
+  rp->window_access = 0;
+}
+
+///////////////////////////////////////////////////////////////////
+// Unsampled lines cost a multiply and a compare
+///////////////////////////////////////////////////////////////////
+
+void    reuse_access(Reuse_Prof *rp, Addr lineaddr, Access_Type type){
+  uns cls = type;
+
+  rp->stat_access[cls]++;
+  rp->stat_access[REUSE_CLASS_ALL]++;
+  if(++rp->window_access > rp->window_size){
+    reuse_close_window(rp);
+    rp->window_access = 1;
+  }
+
+  if(((lineaddr * REUSE_SAMPLE_HASH) >> 32) % rp->sample_rate){
+    return;
+  }
+
+  rp->stat_sampled[cls]++;
+  rp->stat_sampled[REUSE_CLASS_ALL]++;
+  if(rp->now == rp->tree_size){
+    reuse_compact(rp);
+  }
+
+  Reuse_Entry *e = reuse_find(rp->table, rp->table_mask, lineaddr);
+  if(e->lineaddr == 0){
+    e->lineaddr = lineaddr+1;
+    rp->table_count++;
+    rp->stat_cold[cls]++;
+    rp->stat_cold[REUSE_CLASS_ALL]++;
+  } else {
+    uns64 dist = reuse_tree_prefix(rp, rp->now) - reuse_tree_prefix(rp, e->time+1);
+    hist_add(&rp->stat_dist[cls], dist*rp->sample_rate);
+    hist_add(&rp->stat_dist[REUSE_CLASS_ALL], dist*rp->sample_rate);
+    reuse_tree_add(rp, e->time, -1);
+  }
+  reuse_tree_add(rp, rp->now, 1);
+  e->time = rp->now++;
+
+  uns window = rp->window+1;
+  if(e->window[cls] != window){
+    e->window[cls] = window;
+    rp->ws_lines[cls]++;
+  }
+  if(e->window[REUSE_CLASS_ALL] != window){
+    e->window[REUSE_CLASS_ALL] = window;
+    rp->ws_lines[REUSE_CLASS_ALL]++;
+  }
+
+  if(2*rp->table_count > rp->table_mask){
+    reuse_grow(rp);
+  }
+}
+
+///////////////////////////////////////////////////////////////////
+// Profile the whole trace, with the same reader the cores use
+///////////////////////////////////////////////////////////////////
+
+void    reuse_run(Reuse_Prof *rp, Core *c){
+  while(!c->done){
+    reuse_access(rp, c->trace_inst_addr/CACHE_LINESIZE, ACCESS_TYPE_IFETCH);
+    if(c->trace_inst_type == INST_TYPE_LOAD){
+      reuse_access(rp, c->trace_ldst_addr/CACHE_LINESIZE, ACCESS_TYPE_LOAD);
+    }
+    if(c->trace_inst_type == INST_TYPE_STORE){
+      reuse_access(rp, c->trace_ldst_addr/CACHE_LINESIZE, ACCESS_TYPE_STORE);
+    }
+    c->inst_count++;
+    core_read_trace(c);
+  }
+
+  // a trace shorter than one window still gets its working set
+  if(rp->stat_windows == 0){
+    reuse_close_window(rp);
+  }
+}
+
+///////////////////////////////////////////////////////////////////
+// Distances in lines, working sets in KB, and the LRU miss ratio
+// curve from REUSE_MRC_MIN_KB to REUSE_MRC_MAX_KB (exact for the
+// sampled lines, since cache sizes fall on histogram bucket edges)
+///////////////////////////////////////////////////////////////////
+
+void    reuse_print_stats(Reuse_Prof *rp, char *header){
+  char cls_header[256];
+
+  printf("\n%s_SAMPLE_RATE   \t\t : %10llu", header, rp->sample_rate);
+  printf("\n%s_WINDOWS       \t\t : %10llu", header, rp->stat_windows);
+
+  for(uns cc=0; cc<REUSE_CLASSES; cc++){
+    uns64  sampled = rp->stat_sampled[cc];
+    double ws_avg  = rp->stat_windows ? rp->stat_ws_sum[cc]/(double)(rp->stat_windows) : 0;
+    Hist  *h       = &rp->stat_dist[cc];
+
+    if(rp->stat_access[cc] == 0){
+      continue;
+    }
+
+    sprintf(cls_header, "%s_%s", header, reuse_class_name[cc]);
+    printf("\n");
+    printf("\n%s_ACCESS        \t\t : %10llu", cls_header, rp->stat_access[cc]);
+    printf("\n%s_SAMPLED       \t\t : %10llu", cls_header, sampled);
+    printf("\n%s_COLD_PERC     \t\t : %10.3f", cls_header,
+           sampled ? 100*(double)(rp->stat_cold[cc])/(double)(sampled) : 0);
+    printf("\n%s_DIST_P50      \t\t : %10llu", cls_header, hist_percentile(h, 50));
+    printf("\n%s_DIST_P90      \t\t : %10llu", cls_header, hist_percentile(h, 90));
+    printf("\n%s_DIST_P99      \t\t : %10llu", cls_header, hist_percentile(h, 99));
+    printf("\n%s_WS_AVG_KB     \t\t : %10.1f", cls_header, ws_avg*(double)(CACHE_LINESIZE)/1024.0);
+    printf("\n%s_WS_MAX_KB     \t\t : %10.1f", cls_header,
+           (double)(rp->stat_ws_max[cc]*CACHE_LINESIZE)/1024.0);
+
+    for(uns64 kb=REUSE_MRC_MIN_KB; kb<=REUSE_MRC_MAX_KB; kb*=2){
+      uns64 lines  = kb*1024/CACHE_LINESIZE;
+      uns64 misses = sampled - hist_count_below(h, lines);
+      printf("\n%s_MR_%lluKB  \t\t : %10.3f", cls_header, kb,
+             sampled ? 100*(double)(misses)/(double)(sampled) : 0);
+    }
+  }
+  printf("\n");
+}
@@ -0,0 +1,81 @@
+#ifndef REUSE_H
+#define REUSE_H
+
+#include "types.h"
+#include "hist.h"
+#include "core.h"
+
+#define REUSE_CLASSES     4   // ifetch, load, store, and all of them
+#define REUSE_CLASS_ALL   3
+
+typedef struct Reuse_Prof  Reuse_Prof;
+typedef struct Reuse_Entry Reuse_Entry;
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+// Reuse-distance and working-set profile of one core's trace, with no
+// timing model (-reuse 1). The reuse distance of an access is the
+// number of distinct lines touched since the previous access to its
+// line, so an LRU cache of C lines misses exactly the accesses with
+// distance >= C: one pass gives the miss ratio of every cache size.
+//
+// Distances are measured over all of the core's accesses (as a
+// unified cache sees them) and binned by the type of the reusing
+// access. Only lines whose hash falls in 1 of sample_rate buckets are
+// tracked (SHARDS, Waldspurger et al., FAST'15), which keeps every
+// reuse of a sampled line; distances among sampled lines are scaled
+// back up by sample_rate. Exact distances among the sampled lines
+// come from a Fenwick tree over access timestamps that holds a 1 at
+// the latest access of every live line, renumbered when it fills.
+
+struct Reuse_Entry {
+  Addr   lineaddr;        // +1, 0 is an empty slot
+  uns64  time;            // latest access, in sampled accesses
+  uns    window[REUSE_CLASSES]; // last working-set window touched, +1
+};
+
+struct Reuse_Prof {
+  uns    core_id;
+  uns64  sample_rate;
+  uns64  window_size;     // accesses per working-set window
+
+  // lines seen, open addressing
+  Reuse_Entry *table;
+  uns64  table_mask;
+  uns64  table_count;
+
+  // Fenwick tree over timestamps [0, tree_size)
+  uns   *tree;
+  uns64  tree_size;
+  uns64  now;             // next timestamp
+
+  // working set of the current window, in sampled lines
+  uns64  window;
+  uns64  window_access;
+  uns64  ws_lines[REUSE_CLASSES];
+  FILE  *ws_fp;
+
+  // stats
+  uns64  stat_access[REUSE_CLASSES];
+  uns64  stat_sampled[REUSE_CLASSES];
+  uns64  stat_cold[REUSE_CLASSES];
+  Hist   stat_dist[REUSE_CLASSES];      // scaled distances, in lines
+  uns64  stat_windows;
+  double stat_ws_sum[REUSE_CLASSES];    // lines
+  uns64  stat_ws_max[REUSE_CLASSES];
+};
+
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Reuse_Prof *reuse_new(uns core_id, FILE *ws_fp);
+void    reuse_access(Reuse_Prof *rp, Addr lineaddr, Access_Type type);
+void    reuse_run(Reuse_Prof *rp, Core *c);
+void    reuse_print_stats(Reuse_Prof *rp, char *header);
+
+
+
+#endif // REUSE_H
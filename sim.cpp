@@ -14,6 +14,10 @@
 #include "types.h"
 #include "memsys.h"
 #include "core.h"
+#include "cat.h"
+#include "dramtiming.h"
+#include "reuse.h"
+#include "fairness.h"
 
 #define PRINT_DOTS   1
 #define DOT_INTERVAL 100000
@@ -24,31 +28,82 @@
 
 MODE        SIM_MODE        = SIM_MODE_A;
 uns64       CACHE_LINESIZE  = 64;
-uns64       REPL_POLICY     = 0; // 0:LRU 1:RAND 2:SWP (Part E)  3:NEW (Part F)
+uns64       REPL_POLICY     = 0; // 0:LRU 1:RAND 2:SWP (Part E)  3:UCP (Part F)
 
 uns64       DCACHE_SIZE     = 32*1024; 
 uns64       DCACHE_ASSOC    = 8; 
 
+uns64       VCACHE_ENTRIES  = 0; // victim cache lines behind each DCACHE (0: none)
+uns64       WBB_ENTRIES     = 0; // writeback buffer entries behind each DCACHE (0: none)
+
 uns64       ICACHE_SIZE     = 32*1024; 
 uns64       ICACHE_ASSOC    = 8; 
 
 uns64       L2CACHE_SIZE    = 1024*1024; 
 uns64       L2CACHE_ASSOC   = 16;
 uns64       L2CACHE_REPL    = 0;
-
-// We are sampling 1 set among 16 sets in UMON
-// there will be 64 sets in UMON with 16 way Associative
-// There are 1024 sets in L2 cache sampling 1 out of every
-// 16 will give 64 sets
-uns64       UMON_SIZE    = 64*1024; 
-uns64       UMON_ASSOC   = 16;
-uns64       UMON_REPL    = 3;
-
-uns64       SWP_CORE0_WAYS  = 0; // using this variable for UCP, also
+uns64       L2CACHE_SAMPLE  = 1; // simulate tags for 1 in N L2 sets
+uns64       L2CACHE_PACKED  = 0; // 8-byte packed L2 line metadata
+uns64       L2CACHE_DBP     = 0; // L2 dead block predictor 0:off 1:replacement 2:replacement+bypass
+
+uns64       L1CACHE_INDEX   = 1; // set index function 0:MOD 1:MASK 2:XOR 3:SKEW
+uns64       L2CACHE_INDEX   = 1; // (MASK falls back to MOD for non power-of-two sets)
+
+// UCP (L2CACHE_REPL 3): each core's UMON shadows 1 in UMON_SAMPLE
+// L2 sets, and ways are reallocated every UCP_INTERVAL cycles
+uns64       UMON_SAMPLE     = 32;
+uns64       UCP_INTERVAL    = 5000000;
+
+uns64       SWP_CORE0_WAYS  = 0;
+
+uns64       DRAM_CTRL       = 0; // queued FR-FCFS DRAM controller instead of closed-form latency
+uns64       DRAM_CHANNELS   = 1;
+uns64       DRAM_RANKS      = 1; // per channel
+uns64       DRAM_BANKS      = 16; // per rank
+uns64       DRAM_ROWBUF_SIZE = 1024; // bytes
+uns64       DRAM_MAPPING    = 0; // 0:row:bank:col 1:row:col:bank 2:XOR bank permutation
+uns64       DRAM_CH_INTERLEAVE = 1024; // bytes sent to one channel before the next
+uns64       DRAM_PAGE_POLICY = 0; // 0:open 1:closed 2:timeout 3:adaptive
+uns64       DRAM_PAGE_TIMEOUT = 400; // idle cycles before a timeout policy closes the row
+uns64       DRAM_REFRESH    = 0; // 0:off 1:all-bank 2:per-bank
+uns64       DRAM_T_REFI     = 0; // cycles, 0: from the DRAM timing preset
+uns64       DRAM_T_RFC      = 0;
+uns64       DRAM_WQ_HIGH    = 48; // controller write queue: drain from high to low watermark
+uns64       DRAM_WQ_LOW     = 16;
+uns64       DRAM_ENERGY     = 0; // print DRAM energy/power even for the default organization
+uns64       CORE_FREQ_MHZ   = 3200; // to turn DRAM timings into core cycles
+uns64       DRAM_SAMPLE_INTERVAL = 0; // cycles per DRAM time-series sample (0: none)
+char        DRAM_SAMPLE_FILE[1024] = "dram_samples.csv";
+
+uns64       MCACHE_SIZE     = 0; // DRAM cache between L2 and DRAM in bytes (0: none)
+uns64       MCACHE_ORG      = 0; // 0:Alloy direct-mapped 1:page-based
+uns64       MCACHE_ASSOC    = 4; // page-based only
+uns64       MCACHE_PAGE_SIZE = 2048; // bytes, page-based only
+uns64       MCACHE_CHANNELS = 8;
+char        MCACHE_TIMING[32] = "HBM2-2000";
 
 uns64       NUM_CORES       = 1;
-
-uns64		utl_cnt[16][2]	= {{0}};
+uns64       CORE_ROB_SIZE   = 0; // out-of-order window per core (0: blocking in-order core)
+uns64       CORE_WIDTH      = 4; // fetch/retire width of the out-of-order core
+uns64       CORE_MSHRS      = 16; // outstanding load misses per out-of-order core
+uns64       LAT_HIST        = 0; // per-core, per-type memsys latency percentiles
+uns64       MISS_CLASS      = 0; // compulsory/capacity/conflict breakdown for every cache
+uns64       PCPROF_TOP      = 0; // print the top N load/store PCs by memory cycles (0: no profile)
+
+uns64       REUSE_PROFILE   = 0; // analysis only: reuse distances and working sets, no timing
+uns64       REUSE_SAMPLE_RATE = 64; // track 1 in N lines (SHARDS), 1 is exact
+uns64       REUSE_WINDOW    = 10000000; // accesses per working-set window, per core
+char        REUSE_WS_FILE[1024] = "";
+
+uns64       FAIRNESS        = 0; // compare each core with its trace run alone
+char        FAIRNESS_CACHE_FILE[1024] = "alone_ipc.cache"; // alone-run counts, by trace and options
+
+uns64       TLB_ENABLE      = 0; // Per-core TLBs + page walker (Part D,E)
+uns64       TLB_HUGEPAGE    = 0; // Map everything with 2MB pages
+uns64       L1TLB_ENTRIES   = 64;
+uns64       L1TLB_ASSOC     = 4;
+uns64       L2TLB_ENTRIES   = 1024;
+uns64       L2TLB_ASSOC     = 8;
 
 /***************************************************************************************
  * Functions
@@ -58,6 +113,7 @@ void die_usage();
 void die_message(const char * msg);
 void get_params(int argc, char** argv);
 void print_stats();
+void run_reuse_profile();
 
 /***************************************************************************************
  * Globals
@@ -82,6 +138,11 @@ int main(int argc, char** argv)
 
     assert(NUM_CORES<=MAX_CORES);
 
+    if(REUSE_PROFILE){
+	run_reuse_profile();
+	return 0;
+    }
+
     //---- Initiliaze the system
     memsys = memsys_new();
 
@@ -110,8 +171,17 @@ int main(int argc, char** argv)
       
       cycle++; 
     }
+
+    // lines still waiting in writeback buffers go to the L2 first
+    for(ii=0; ii<NUM_CORES; ii++){
+      memsys_wbb_flush(memsys, ii);
+    }
     
     print_stats();
+
+    if(FAIRNESS){
+	fairness_print_stats(core, NUM_CORES, argc, argv);
+    }
     return 0;
 }
 
@@ -160,6 +230,41 @@ void print_dots(){
 }
 
 
+//--------------------------------------------------------------------
+// -- Reuse-distance profile of each trace, no memory system
+//--------------------------------------------------------------------
+
+void run_reuse_profile(){
+  FILE *ws_fp = NULL;
+  char header[256];
+
+  if(REUSE_WS_FILE[0]){
+    ws_fp = fopen(REUSE_WS_FILE, "w");
+    if(ws_fp == NULL){
+      die_message("Unable to open the working-set file");
+    }
+    fprintf(ws_fp, "core,window,ws_kb_ifetch,ws_kb_load,ws_kb_store,ws_kb_all\n");
+  }
+
+  printf("\n");
+  for(uns ii=0; ii<NUM_CORES; ii++){
+    Core *c = core_new(NULL, trace_filename[ii], ii);
+    Reuse_Prof *rp = reuse_new(ii, ws_fp);
+    reuse_run(rp, c);
+
+    sprintf(header, "REUSE_%u", ii);
+    printf("\n%s_INST          \t\t : %10llu", header, c->inst_count);
+    reuse_print_stats(rp, header);
+    pclose(c->trace);
+  }
+  printf("\n\n");
+
+  if(ws_fp){
+    fclose(ws_fp);
+  }
+}
+
+
 //--------------------------------------------------------------------
 // -- Usage Menu
 //--------------------------------------------------------------------
@@ -168,13 +273,69 @@ void die_usage() {
     printf("Usage : sim [-option <value>] trace_0 <trace_1> \n");
     printf("   Options\n");
     printf("      -mode            <num>    Set mode of the simulator[1:PartA, 2:PartB, 3:PartC 4:PartD 5:PartE 6:PartF]  (Default: 1)\n");
+    printf("      -rob             <num>    Out-of-order core with a <num>-entry ROB, loads overlap (Default:0, blocking core)\n");
+    printf("      -width           <num>    Fetch and retire width of the out-of-order core (Default:4)\n");
+    printf("      -mshr            <num>    Outstanding load misses per out-of-order core (Default:16)\n");
     printf("      -linesize        <num>    Set cache linesize for all caches (Default:64)\n");
     printf("      -repl            <num>    Set replacement policy for L1 cache [0:LRU,1:RND] (Default:0)\n");
     printf("      -DsizeKB         <num>    Set capacity in KB of the the Level 1 DCACHE (Default:32 KB)\n");
     printf("      -Dassoc          <num>    Set associativity of the the Level 1 DCACHE (Default:8)\n");
+    printf("      -VCentries       <num>    Add a fully associative victim cache of <num> lines behind each DCACHE (Default:0)\n");
+    printf("      -WBBentries      <num>    Buffer dirty DCACHE evictions in a <num>-entry writeback buffer (Default:0)\n");
     printf("      -L2sizeKB        <num>    Set capacity in KB of the unified Level 2 cache (Default: 512 KB)\n");
-    printf("      -L2repl          <num>    Set replacement policy for L2 cache [0:LRU,1:RND,2:SWP, 3:NEW] (Default:0)\n");
+    printf("      -L2repl          <num>    Set replacement policy for L2 cache [0:LRU,1:RND,2:SWP, 3:UCP] (Default:0)\n");
     printf("      -SWP_core0ways   <num>    Set static quota for core_0 for SWP (Default:1)\n");
+    printf("      -L1index         <num>    Set index function of L1 caches [0:MOD,1:MASK,2:XOR,3:SKEW] (Default:1)\n");
+    printf("      -L2index         <num>    Set index function of the L2 cache [0:MOD,1:MASK,2:XOR,3:SKEW] (Default:1)\n");
+    printf("      -L2sample        <num>    Keep L2 tags for only 1 in <num> sets, extrapolate the rest (Default:1)\n");
+    printf("      -L2packed        <num>    Pack L2 line metadata into 8 bytes, for very large L2s [0:off,1:on] (Default:0)\n");
+    printf("      -L2dbp           <num>    L2 dead block predictor [0:off,1:evict dead first,2:also bypass dead fills] (Default:0)\n");
+    printf("      -L2mask          <c:mask> Restrict L2 allocation of core c to the ways in mask, e.g. 1:0xff00\n");
+    printf("      -L2maskcfg       <file>   Load L2 class-of-service masks and a mid-run mask schedule from file\n");
+    printf("      -UMONsample      <num>    Set UCP utility monitor sampling to 1 in <num> L2 sets (Default:32)\n");
+    printf("      -UCPinterval     <num>    Set cycles between UCP repartitions (Default:5000000)\n");
+    printf("      -missclass       <num>    Split the misses of every cache into compulsory/capacity/conflict [0:off,1:on] (Default:0)\n");
+    printf("      -fairness        <num>    Report slowdowns, weighted/harmonic speedup and unfairness against alone runs [0:off,1:on] (Default:0)\n");
+    printf("      -alonecache      <file>   Cache of alone-run results, by trace and options (Default:alone_ipc.cache)\n");
+    printf("      -reuse           <num>    Only profile reuse distances and working sets of each trace, no timing [0:off,1:on] (Default:0)\n");
+    printf("      -reuserate       <num>    Track 1 in <num> lines for -reuse, 1 is exact (Default:64)\n");
+    printf("      -reusewindow     <num>    Set accesses per working-set window for -reuse (Default:10000000)\n");
+    printf("      -reusewsfile     <file>   Write the working set of every window to file as CSV\n");
+    printf("      -pcprof          <num>    Profile misses per load/store PC, print the top <num> by memory cycles (Default:0)\n");
+    printf("      -lathist         <num>    Report p50/p90/p99/p99.9 memory latency per core and access type [0:off,1:on] (Default:0)\n");
+    printf("      -tlb             <num>    Model per-core TLBs and page walks in Part D,E [0:off,1:on] (Default:0)\n");
+    printf("      -hugepage        <num>    Map memory with 2MB pages when TLBs are modeled (Default:0)\n");
+    printf("      -L1TLBentries    <num>    Set entries in each L1 ITLB/DTLB (Default:64)\n");
+    printf("      -L2TLBentries    <num>    Set entries in the unified L2 TLB (Default:1024)\n");
+    printf("      -dramctrl        <num>    Time DRAM with a queued FR-FCFS controller in Part C,D,E [0:off,1:on] (Default:0)\n");
+    printf("      -dramchannels    <num>    Set DRAM channels (Default:1)\n");
+    printf("      -dramranks       <num>    Set DRAM ranks per channel (Default:1)\n");
+    printf("      -drambanks       <num>    Set DRAM banks per rank (Default:16)\n");
+    printf("      -dramrowsize     <num>    Set DRAM row buffer size in bytes (Default:1024)\n");
+    printf("      -drammap         <num>    Set DRAM address mapping [0:row:bank:col 1:row:col:bank 2:XOR bank] (Default:0)\n");
+    printf("      -dramchgran      <num>    Set DRAM channel interleaving granularity in bytes (Default:1024)\n");
+    printf("      -drampage        <num>    Set DRAM page policy [0:open 1:closed 2:timeout 3:adaptive] (Default:0)\n");
+    printf("      -drampagetimeout <num>    Set idle cycles before the timeout page policy closes a row (Default:400)\n");
+    printf("      -dramrefresh     <num>    Model DRAM refresh [0:off 1:all-bank 2:per-bank] (Default:0)\n");
+    printf("      -dramtrefi       <num>    Set cycles between refreshes of a bank (Default: from DRAM timing)\n");
+    printf("      -dramtrfc        <num>    Set cycles a refresh blocks the bank (Default: from DRAM timing)\n");
+    printf("      -dramwqhigh      <num>    Start draining the DRAM write queue at <num> writes (Default:48, max 64)\n");
+    printf("      -dramwqlow       <num>    Stop draining the DRAM write queue at <num> writes (Default:16)\n");
+    printf("      -dramtiming      <name>   Use DRAM timing preset legacy, DDR3-1600, DDR4-2400, DDR4-3200,\n");
+    printf("                                DDR5-4800, DDR5-6400, LPDDR4-3200 or HBM2-2000 (Default:legacy)\n");
+    printf("      -dramcfg         <file>   Load DRAM timings from file\n");
+    printf("      -dramenergy      <num>    Report DRAM energy and power [0:off,1:on] (Default:0, also on with -dramctrl 1,\n");
+    printf("                                -dramchannels/-dramranks above 1, or a non-default -drammap, -drampage,\n");
+    printf("                                -dramrefresh or -dramtiming)\n");
+    printf("      -corefreq        <num>    Set core clock in MHz, for DRAM timing presets (Default:3200)\n");
+    printf("      -dramsample      <num>    Write DRAM bandwidth, latency and row hits every <num> cycles as CSV (Default:0)\n");
+    printf("      -dramsamplefile  <file>   Set the file for -dramsample (Default:dram_samples.csv)\n");
+    printf("      -MCsizeMB        <num>    Add a DRAM cache of <num> MB between L2 and DRAM in Part C,D,E (Default:0)\n");
+    printf("      -MCorg           <num>    Set DRAM cache organization [0:Alloy direct-mapped 1:page-based] (Default:0)\n");
+    printf("      -MCassoc         <num>    Set associativity of the page-based DRAM cache (Default:4)\n");
+    printf("      -MCpage          <num>    Set page size in bytes of the page-based DRAM cache (Default:2048)\n");
+    printf("      -MCchannels      <num>    Set DRAM cache channels (Default:8)\n");
+    printf("      -MCtiming        <name>   Use DRAM timing preset <name> for the DRAM cache (Default:HBM2-2000)\n");
     exit(0);
 }
 
@@ -214,12 +375,33 @@ void get_params(int argc, char** argv){
      		  SIM_MODE = (MODE) atoi(argv[ii+1]);
      		  if (SIM_MODE==SIM_MODE_F)
      		  {
-     		  	SWP_CORE0_WAYS = 8; // providing initial value for this part
+     		  	L2CACHE_REPL = REPL_UCP; // Part F is Part E with UCP in the L2
      		  }
 		  ii += 1;
 		}
 	    }
 
+	    else if (!strcmp(argv[ii], "-rob")) {
+		if (ii < argc - 1) {		  
+		    CORE_ROB_SIZE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-width")) {
+		if (ii < argc - 1) {		  
+		    CORE_WIDTH = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-mshr")) {
+		if (ii < argc - 1) {		  
+		    CORE_MSHRS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
 	    else if (!strcmp(argv[ii], "-linesize")) {
 		if (ii < argc - 1) {		  
 		    CACHE_LINESIZE = atoi(argv[ii+1]);
@@ -248,6 +430,20 @@ void get_params(int argc, char** argv){
 		}
 	    }
 
+	    else if (!strcmp(argv[ii], "-WBBentries")) {
+		if (ii < argc - 1) {		  
+		    WBB_ENTRIES = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-VCentries")) {
+		if (ii < argc - 1) {		  
+		    VCACHE_ENTRIES = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
 	    else if (!strcmp(argv[ii], "-L2sizeKB")) {
 		if (ii < argc - 1) {		  
 		    L2CACHE_SIZE = atoi(argv[ii+1])*1024;
@@ -268,6 +464,362 @@ void get_params(int argc, char** argv){
 		    ii += 1;
 		}
 	    }
+
+	    else if (!strcmp(argv[ii], "-L1index")) {
+		if (ii < argc - 1) {		  
+		    L1CACHE_INDEX = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2index")) {
+		if (ii < argc - 1) {		  
+		    L2CACHE_INDEX = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2sample")) {
+		if (ii < argc - 1) {		  
+		    L2CACHE_SAMPLE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2packed")) {
+		if (ii < argc - 1) {		  
+		    L2CACHE_PACKED = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2dbp")) {
+		if (ii < argc - 1) {		  
+		    L2CACHE_DBP = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2mask")) {
+		if (ii < argc - 1) {		  
+		    char line[256];
+		    char arg[128];
+		    snprintf(arg, sizeof(arg), "%s", argv[ii+1]); // argv is re-read for -fairness
+		    char *sep = strchr(arg, ':');
+		    if (sep == NULL) {
+			die_message("-L2mask expects <core>:<mask>");
+		    }
+		    *sep = 0;
+		    snprintf(line, sizeof(line), "core %s mask %s", arg, sep+1);
+		    if (!cat_parse_line(line)) {
+			die_message("-L2mask expects <core>:<mask>");
+		    }
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2maskcfg")) {
+		if (ii < argc - 1) {		  
+		    cat_load_config(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-UMONsample")) {
+		if (ii < argc - 1) {		  
+		    UMON_SAMPLE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-UCPinterval")) {
+		if (ii < argc - 1) {		  
+		    UCP_INTERVAL = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-tlb")) {
+		if (ii < argc - 1) {		  
+		    TLB_ENABLE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-hugepage")) {
+		if (ii < argc - 1) {		  
+		    TLB_HUGEPAGE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L1TLBentries")) {
+		if (ii < argc - 1) {		  
+		    L1TLB_ENTRIES = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2TLBentries")) {
+		if (ii < argc - 1) {		  
+		    L2TLB_ENTRIES = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-missclass")) {
+		if (ii < argc - 1) {		  
+		    MISS_CLASS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-fairness")) {
+		if (ii < argc - 1) {		  
+		    FAIRNESS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-alonecache")) {
+		if (ii < argc - 1) {		  
+		    strcpy(FAIRNESS_CACHE_FILE, argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-reuse")) {
+		if (ii < argc - 1) {		  
+		    REUSE_PROFILE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-reuserate")) {
+		if (ii < argc - 1) {		  
+		    REUSE_SAMPLE_RATE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-reusewindow")) {
+		if (ii < argc - 1) {		  
+		    REUSE_WINDOW = atoll(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-reusewsfile")) {
+		if (ii < argc - 1) {		  
+		    snprintf(REUSE_WS_FILE, sizeof(REUSE_WS_FILE), "%s", argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-pcprof")) {
+		if (ii < argc - 1) {		  
+		    PCPROF_TOP = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-lathist")) {
+		if (ii < argc - 1) {		  
+		    LAT_HIST = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramctrl")) {
+		if (ii < argc - 1) {		  
+		    DRAM_CTRL = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramchannels")) {
+		if (ii < argc - 1) {		  
+		    DRAM_CHANNELS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramranks")) {
+		if (ii < argc - 1) {		  
+		    DRAM_RANKS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-drambanks")) {
+		if (ii < argc - 1) {		  
+		    DRAM_BANKS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramrowsize")) {
+		if (ii < argc - 1) {		  
+		    DRAM_ROWBUF_SIZE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-drammap")) {
+		if (ii < argc - 1) {		  
+		    DRAM_MAPPING = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramchgran")) {
+		if (ii < argc - 1) {		  
+		    DRAM_CH_INTERLEAVE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-drampage")) {
+		if (ii < argc - 1) {		  
+		    DRAM_PAGE_POLICY = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-drampagetimeout")) {
+		if (ii < argc - 1) {		  
+		    DRAM_PAGE_TIMEOUT = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramrefresh")) {
+		if (ii < argc - 1) {		  
+		    DRAM_REFRESH = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramtrefi")) {
+		if (ii < argc - 1) {		  
+		    DRAM_T_REFI = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramtrfc")) {
+		if (ii < argc - 1) {		  
+		    DRAM_T_RFC = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramwqhigh")) {
+		if (ii < argc - 1) {		  
+		    DRAM_WQ_HIGH = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramwqlow")) {
+		if (ii < argc - 1) {		  
+		    DRAM_WQ_LOW = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramtiming")) {
+		if (ii < argc - 1) {		  
+		    if (!dramtiming_set_preset(argv[ii+1])) {
+			char msg[256];
+			snprintf(msg, sizeof(msg), "Unknown DRAM timing preset %s", argv[ii+1]);
+			die_message(msg);
+		    }
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramcfg")) {
+		if (ii < argc - 1) {		  
+		    dramtiming_load_config(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramenergy")) {
+		if (ii < argc - 1) {		  
+		    DRAM_ENERGY = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-corefreq")) {
+		if (ii < argc - 1) {		  
+		    CORE_FREQ_MHZ = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramsample")) {
+		if (ii < argc - 1) {		  
+		    DRAM_SAMPLE_INTERVAL = atoll(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramsamplefile")) {
+		if (ii < argc - 1) {		  
+		    snprintf(DRAM_SAMPLE_FILE, sizeof(DRAM_SAMPLE_FILE), "%s", argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-MCsizeMB")) {
+		if (ii < argc - 1) {		  
+		    MCACHE_SIZE = atoi(argv[ii+1])*1024*1024ULL;
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-MCorg")) {
+		if (ii < argc - 1) {		  
+		    MCACHE_ORG = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-MCassoc")) {
+		if (ii < argc - 1) {		  
+		    MCACHE_ASSOC = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-MCpage")) {
+		if (ii < argc - 1) {		  
+		    MCACHE_PAGE_SIZE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-MCchannels")) {
+		if (ii < argc - 1) {		  
+		    MCACHE_CHANNELS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-MCtiming")) {
+		if (ii < argc - 1) {		  
+		    if (!dramtiming_find(argv[ii+1])) {
+			char msg[256];
+			snprintf(msg, sizeof(msg), "Unknown DRAM timing preset %s", argv[ii+1]);
+			die_message(msg);
+		    }
+		    snprintf(MCACHE_TIMING, sizeof(MCACHE_TIMING), "%s", argv[ii+1]);
+		    ii += 1;
+		}
+	    }
 	    
 	    else {
 		char msg[256];
@@ -294,6 +846,30 @@ void get_params(int argc, char** argv){
 	die_message("Must provide at least one trace file");
     }
 
+    if ((L2CACHE_REPL==REPL_UCP) && SWP_CORE0_WAYS) {
+	die_message("SWP and UCP both partition the L2, pick one");
+    }
+
+    if (FAIRNESS && (NUM_CORES<2)) {
+	die_message("-fairness needs a multi-core run, give at least two traces");
+    }
+
+    if (REUSE_PROFILE && ((REUSE_SAMPLE_RATE==0) || (REUSE_WINDOW==0))) {
+	die_message("-reuserate and -reusewindow must be at least 1");
+    }
+
+    if (CORE_ROB_SIZE && ((CORE_WIDTH==0) || (CORE_MSHRS==0))) {
+	die_message("-width and -mshr must be at least 1");
+    }
+
+    if (L2CACHE_DBP && L2CACHE_PACKED) {
+	die_message("-L2dbp needs unpacked L2 lines, drop -L2packed");
+    }
+
+    if ((L2CACHE_REPL==REPL_UCP) && cat_configured()) {
+	die_message("UCP manages the L2 way masks, drop -L2mask/-L2maskcfg");
+    }
+
 
   
 }
@@ -0,0 +1,123 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tlb.h"
+
+//---- TLB Latencies ------
+
+#define L1TLB_HIT_LATENCY   0  // looked up in parallel with the L1 cache
+#define L2TLB_HIT_LATENCY   7
+
+// Page tables live in a physical region far above anything that
+// memsys_convert_vpn_to_pfn can produce, one 4GB slice per level
+// and one 64GB slice per core, so PTE lines never alias data lines.
+#define PT_REGION_BASE      (1ULL<<42)
+
+extern uns64  CACHE_LINESIZE;
+extern uns64  L1TLB_ENTRIES;
+extern uns64  L1TLB_ASSOC;
+extern uns64  L2TLB_ENTRIES;
+extern uns64  L2TLB_ASSOC;
+extern uns64  TLB_HUGEPAGE;
+
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+TLB    *tlb_new(uns core_id){
+  TLB *tlb = (TLB *) calloc (1, sizeof (TLB));
+  tlb->core_id = core_id;
+  tlb->page_shift = TLB_HUGEPAGE ? HUGE_PAGE_SHIFT : 0;
+
+  // a TLB is a cache of page numbers: linesize 1, one entry per "line"
+  tlb->itlb = cache_new(L1TLB_ENTRIES, L1TLB_ASSOC, 1, REPL_LRU, CACHE_LEVEL_L1);
+  tlb->dtlb = cache_new(L1TLB_ENTRIES, L1TLB_ASSOC, 1, REPL_LRU, CACHE_LEVEL_L1);
+  tlb->stlb = cache_new(L2TLB_ENTRIES, L2TLB_ASSOC, 1, REPL_LRU, CACHE_LEVEL_L1);
+
+  return tlb;
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+void    tlb_print_stats(TLB *tlb, char *header){
+  char tlb_header[256];
+  double walk_delay_avg=0;
+
+  if(tlb->stat_walks){
+    walk_delay_avg=(double)(tlb->stat_walk_delay)/(double)(tlb->stat_walks);
+  }
+
+  sprintf(tlb_header, "%s_ITLB", header);
+  cache_print_stats(tlb->itlb, tlb_header);
+  sprintf(tlb_header, "%s_DTLB", header);
+  cache_print_stats(tlb->dtlb, tlb_header);
+  sprintf(tlb_header, "%s_STLB", header);
+  cache_print_stats(tlb->stlb, tlb_header);
+
+  printf("\n%s_PAGE_WALKS      \t\t : %10llu", header, tlb->stat_walks);
+  printf("\n%s_WALK_PTE_ACCESS \t\t : %10llu", header, tlb->stat_walk_pte_access);
+  printf("\n%s_WALK_AVGDELAY   \t\t : %10.3f", header, walk_delay_avg);
+  printf("\n");
+}
+
+///////////////////////////////////////////////////////////////////
+// Look up a 4KB virtual page number. Returns the translation delay
+// spent in the TLBs; outcome is MISS only if a page walk is needed
+// (the caller walks and then calls tlb_install).
+///////////////////////////////////////////////////////////////////
+
+uns64   tlb_lookup(TLB *tlb, uns64 vpn, Access_Type type, Flag *outcome){
+  uns64 delay = L1TLB_HIT_LATENCY;
+  uns64 tlb_vpn = vpn >> tlb->page_shift;
+  Cache *l1tlb = (type == ACCESS_TYPE_IFETCH) ? tlb->itlb : tlb->dtlb;
+
+  *outcome = cache_access(l1tlb, tlb_vpn, 0, tlb->core_id);
+  if(*outcome == HIT){
+    return delay;
+  }
+
+  delay += L2TLB_HIT_LATENCY;
+  *outcome = cache_access(tlb->stlb, tlb_vpn, 0, tlb->core_id);
+  if(*outcome == HIT){
+    cache_install(l1tlb, tlb_vpn, 0, tlb->core_id);
+  }
+
+  return delay;
+}
+
+///////////////////////////////////////////////////////////////////
+// Fill both levels after a completed page walk
+///////////////////////////////////////////////////////////////////
+
+void    tlb_install(TLB *tlb, uns64 vpn, Access_Type type){
+  uns64 tlb_vpn = vpn >> tlb->page_shift;
+  Cache *l1tlb = (type == ACCESS_TYPE_IFETCH) ? tlb->itlb : tlb->dtlb;
+
+  cache_install(tlb->stlb, tlb_vpn, 0, tlb->core_id);
+  cache_install(l1tlb, tlb_vpn, 0, tlb->core_id);
+}
+
+///////////////////////////////////////////////////////////////////
+// A 2MB mapping is found one level up, in the page directory
+///////////////////////////////////////////////////////////////////
+
+uns     tlb_walk_levels(TLB *tlb){
+  return tlb->page_shift ? PT_LEVELS-1 : PT_LEVELS;
+}
+
+///////////////////////////////////////////////////////////////////
+// Physical line address of the PTE read at 'level' (0 is the root)
+// when walking 'vpn'. Neighbouring pages share PTE lines just like
+// in a real radix table, so walks get cache locality for free.
+///////////////////////////////////////////////////////////////////
+
+Addr    tlb_pte_lineaddr(TLB *tlb, uns64 vpn, uns level){
+  assert(level < PT_LEVELS);
+  uns64 prefix   = vpn >> (PT_BITS_PER_LEVEL*(PT_LEVELS-1-level));
+  uns64 pte_addr = PT_REGION_BASE + ((uns64)(tlb->core_id) << 36) +
+                   ((uns64)(level) << 32) + prefix*PTE_SIZE;
+
+  return pte_addr/CACHE_LINESIZE;
+}
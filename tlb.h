@@ -0,0 +1,50 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include "types.h"
+#include "cache.h"
+
+#define PTE_SIZE            8
+#define PT_LEVELS           4   // x86-64 style 4-level radix page table
+#define PT_BITS_PER_LEVEL   9
+#define HUGE_PAGE_SHIFT     9   // 2MB page = 512 x 4KB pages
+
+typedef struct TLB TLB;
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+// Per-core translation hierarchy: split L1 (ITLB/DTLB) backed by
+// a unified L2 TLB (STLB). Entries are kept in Cache structures
+// indexed by page number (one "line" per page).
+
+struct TLB {
+  uns   core_id;
+  uns   page_shift;   // log2(page size / 4KB): 0 or HUGE_PAGE_SHIFT
+
+  Cache *itlb;
+  Cache *dtlb;
+  Cache *stlb;
+
+  // stats
+  uns64 stat_walks;
+  uns64 stat_walk_delay;
+  uns64 stat_walk_pte_access;
+};
+
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+TLB    *tlb_new(uns core_id);
+void    tlb_print_stats(TLB *tlb, char *header);
+uns64   tlb_lookup(TLB *tlb, uns64 vpn, Access_Type type, Flag *outcome);
+void    tlb_install(TLB *tlb, uns64 vpn, Access_Type type);
+uns     tlb_walk_levels(TLB *tlb);
+Addr    tlb_pte_lineaddr(TLB *tlb, uns64 vpn, uns level);
+
+
+
+
+#endif // TLB_H
@@ -6,7 +6,7 @@
 #define HIT   1
 #define MISS  0
 
-#define MAX_CORES 2
+#define MAX_CORES 16
 
 // Precision for PrintStats
 #define UNS_PREC " %8llu"
@@ -15,6 +15,7 @@
 
 typedef unsigned	    	uns;
 typedef unsigned char	    uns8;
+typedef unsigned short	    uns16;
 typedef unsigned	    uns32;
 typedef unsigned long long  uns64;
 typedef int		    int32;
@@ -0,0 +1,175 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "umon.h"
+
+extern uns64  UMON_SAMPLE;
+extern uns64  UCP_INTERVAL;
+extern uns64  cycle;
+
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+UMON   *umon_new(uns num_cores, Cache *l2cache){
+  UMON *umon = (UMON *) calloc (1, sizeof (UMON));
+  uns64 l2_num_sets  = l2cache->num_sets;
+  uns   num_ways     = l2cache->num_ways;
+  umon->l2cache      = l2cache;
+  umon->num_cores    = num_cores;
+  umon->num_ways     = num_ways;
+  umon->l2_num_sets  = l2_num_sets;
+  umon->sample_ratio = UMON_SAMPLE;
+
+  if((umon->sample_ratio == 0) || (umon->sample_ratio > l2_num_sets)){
+    umon->sample_ratio = l2_num_sets;
+  }
+  // sets 0, ratio, 2*ratio, ... : the last one may be a partial group
+  umon->atd_num_sets = (l2_num_sets + umon->sample_ratio - 1)/umon->sample_ratio;
+
+  if(num_ways < num_cores){
+    printf("UCP needs at least one L2 way per core (%u ways, %u cores)\n", num_ways, num_cores);
+    exit(-1);
+  }
+
+  for(uns ii=0; ii<num_cores; ii++){
+    umon->atd[ii]       = (Addr *) calloc (umon->atd_num_sets*num_ways, sizeof(Addr));
+    umon->atd_valid[ii] = (Flag *) calloc (umon->atd_num_sets*num_ways, sizeof(Flag));
+    umon->alloc[ii]     = num_ways/num_cores; // start from an even split
+  }
+  umon->alloc[0] += num_ways%num_cores;
+  umon->next_partition_cycle = UCP_INTERVAL;
+
+  return umon;
+}
+
+///////////////////////////////////////////////////////////////////
+// Probe core_id's ATD with an L2 demand access. Only sampled sets
+// are looked at; a hit at stack position p counts toward p+1 ways.
+///////////////////////////////////////////////////////////////////
+
+void    umon_access(UMON *umon, Addr lineaddr, uns core_id){
+  uns64 set_index = cache_set_index(umon->l2cache, lineaddr);
+
+  if(set_index % umon->sample_ratio){
+    return;
+  }
+
+  uns64 base  = (set_index/umon->sample_ratio) * umon->num_ways;
+  Addr  *tag  = &umon->atd[core_id][base];
+  Flag  *valid= &umon->atd_valid[core_id][base];
+  uns    pos  = umon->num_ways-1; // on a miss the LRU entry is replaced
+
+  umon->stat_atd_access[core_id]++;
+
+  uns ii;
+  for(ii=0; ii<umon->num_ways; ii++){
+    if(valid[ii] && (tag[ii] == lineaddr)){
+      break;
+    }
+  }
+
+  if(ii < umon->num_ways){
+    umon->utl_cnt[core_id][ii]++;
+    pos = ii;
+  } else {
+    umon->stat_atd_miss[core_id]++;
+  }
+
+  // move to MRU
+  memmove(&tag[1], &tag[0], pos*sizeof(Addr));
+  memmove(&valid[1], &valid[0], pos*sizeof(Flag));
+  tag[0]   = lineaddr;
+  valid[0] = TRUE;
+}
+
+///////////////////////////////////////////////////////////////////
+// Lookahead allocation: hand out ways one batch at a time to the core
+// with the highest marginal utility per way over any batch size, so
+// a core whose utility curve is flat then steep is not starved.
+// Each core keeps at least one way. Allocations become contiguous way
+// masks on the L2, and the utility counters are halved so that the
+// next interval still remembers, but is not dominated by, the past.
+///////////////////////////////////////////////////////////////////
+
+void    umon_partition(UMON *umon, Cache *l2cache){
+  uns   balance = umon->num_ways - umon->num_cores;
+  uns   alloc[MAX_CORES];
+
+  for(uns ii=0; ii<umon->num_cores; ii++){
+    alloc[ii] = 1;
+  }
+
+  while(balance){
+    uns    winner = 0;
+    uns    winner_ways = 1;
+    double winner_mu = -1.0;
+
+    for(uns ii=0; ii<umon->num_cores; ii++){
+      uns64  gain = 0;
+      uns    best_ways = 1;
+      double best_mu = -1.0;
+
+      for(uns kk=1; (kk<=balance) && (alloc[ii]+kk<=umon->num_ways); kk++){
+        gain += umon->utl_cnt[ii][alloc[ii]+kk-1];
+        double mu = (double)(gain)/(double)(kk);
+        if(mu > best_mu){
+          best_mu   = mu;
+          best_ways = kk;
+        }
+      }
+
+      if(best_mu > winner_mu){
+        winner_mu   = best_mu;
+        winner      = ii;
+        winner_ways = best_ways;
+      }
+    }
+
+    alloc[winner] += winner_ways;
+    balance       -= winner_ways;
+  }
+
+  for(uns ii=0; ii<umon->num_cores; ii++){
+    umon->alloc[ii] = alloc[ii];
+    for(uns kk=0; kk<umon->num_ways; kk++){
+      umon->utl_cnt[ii][kk] /= 2;
+    }
+  }
+
+  umon_apply_partition(umon, l2cache);
+  umon->stat_partitions++;
+  umon->next_partition_cycle = cycle + UCP_INTERVAL;
+}
+
+///////////////////////////////////////////////////////////////////
+// Give each core a contiguous run of ways of size alloc[core]
+///////////////////////////////////////////////////////////////////
+
+void    umon_apply_partition(UMON *umon, Cache *l2cache){
+  uns first_way = 0;
+
+  for(uns ii=0; ii<umon->num_cores; ii++){
+    uns64 mask = ((1ULL << umon->alloc[ii]) - 1) << first_way;
+    cache_set_way_mask(l2cache, ii, mask);
+    first_way += umon->alloc[ii];
+  }
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+void    umon_print_stats(UMON *umon, char *header){
+  printf("\n%s_PARTITIONS     \t\t : %10llu", header, umon->stat_partitions);
+  for(uns ii=0; ii<umon->num_cores; ii++){
+    double atd_mr = 0;
+    if(umon->stat_atd_access[ii]){
+      atd_mr = (double)(umon->stat_atd_miss[ii])/(double)(umon->stat_atd_access[ii]);
+    }
+    printf("\n%s_%u_WAYS         \t\t : %10u", header, ii, umon->alloc[ii]);
+    printf("\n%s_%u_ATD_MISS_PERC\t\t : %10.3f", header, ii, 100*atd_mr);
+  }
+  printf("\n");
+}
@@ -0,0 +1,54 @@
+#ifndef UMON_H
+#define UMON_H
+
+#include "types.h"
+#include "cache.h"
+
+typedef struct UMON UMON;
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+// Utility monitor for Utility-based Cache Partitioning (Qureshi & Patt,
+// MICRO'06). Each core has a shadow tag directory (ATD) that mirrors the
+// L2 geometry on a sample of the sets, as if that core owned the whole
+// L2. Every ATD hit bumps the counter of its LRU stack position, so
+// utl_cnt[i][0..w-1] summed gives core i's hits with w ways.
+
+struct UMON {
+  Cache *l2cache;        // for its set index function
+  uns    num_cores;
+  uns    num_ways;
+  uns64  l2_num_sets;
+  uns64  sample_ratio;   // 1 in sample_ratio L2 sets is monitored
+  uns64  atd_num_sets;
+
+  // ATD tags, kept in recency order per set: atd[core][set*ways + 0] is MRU
+  Addr  *atd[MAX_CORES];
+  Flag  *atd_valid[MAX_CORES];
+
+  uns64  utl_cnt[MAX_CORES][MAX_WAYS];
+  uns    alloc[MAX_CORES];   // ways per core from the last partitioning
+
+  uns64  next_partition_cycle;
+
+  // stats
+  uns64  stat_atd_access[MAX_CORES];
+  uns64  stat_atd_miss[MAX_CORES];
+  uns64  stat_partitions;
+};
+
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+UMON   *umon_new(uns num_cores, Cache *l2cache);
+void    umon_access(UMON *umon, Addr lineaddr, uns core_id);
+void    umon_partition(UMON *umon, Cache *l2cache);
+void    umon_apply_partition(UMON *umon, Cache *l2cache);
+void    umon_print_stats(UMON *umon, char *header);
+
+
+
+#endif // UMON_H
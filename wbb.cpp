@@ -0,0 +1,116 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "wbb.h"
+
+extern uns64  cycle;
+
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+WBB    *wbb_new(uns num_entries){
+  WBB *wbb = (WBB *) calloc (1, sizeof (WBB));
+
+  if(num_entries > MAX_WBB_ENTRIES){
+    printf("Change MAX_WBB_ENTRIES in wbb.h to support %u entries\n", num_entries);
+    exit(-1);
+  }
+  wbb->num_entries = num_entries;
+
+  return wbb;
+}
+
+///////////////////////////////////////////////////////////////////
+// Occupancy is integrated over time, so bring it up to date before
+// the number of entries changes
+///////////////////////////////////////////////////////////////////
+
+static void wbb_account(WBB *wbb){
+  wbb->stat_occupancy_sum += (uns64)(wbb->count) * (cycle - wbb->last_update_cycle);
+  wbb->last_update_cycle = cycle;
+}
+
+///////////////////////////////////////////////////////////////////
+// HIT if the line is waiting in the buffer
+///////////////////////////////////////////////////////////////////
+
+Flag    wbb_lookup(WBB *wbb, Addr lineaddr){
+  for(uns ii=0; ii<wbb->count; ii++){
+    if(wbb->lineaddr[(wbb->head + ii) % wbb->num_entries] == lineaddr){
+      return HIT;
+    }
+  }
+  return MISS;
+}
+
+Flag    wbb_full(WBB *wbb){
+  return (wbb->count == wbb->num_entries);
+}
+
+///////////////////////////////////////////////////////////////////
+// Buffer a dirty line that can be written from ready_cycle on.
+// Returns TRUE if it was combined with an entry already buffered.
+// The caller makes room first if the buffer is full.
+///////////////////////////////////////////////////////////////////
+
+Flag    wbb_insert(WBB *wbb, Addr lineaddr, uns64 ready_cycle){
+  if(wbb_lookup(wbb, lineaddr) == HIT){
+    wbb->stat_merge++;
+    return TRUE;
+  }
+
+  assert(!wbb_full(wbb));
+  wbb_account(wbb);
+
+  if(wbb->count == 0){
+    wbb->drain_cycle = (wbb->drain_cycle > ready_cycle) ? wbb->drain_cycle : ready_cycle;
+  }
+  wbb->lineaddr[(wbb->head + wbb->count) % wbb->num_entries] = lineaddr;
+  wbb->count++;
+
+  wbb->stat_insert++;
+  if(wbb->count > wbb->stat_max_occupancy){
+    wbb->stat_max_occupancy = wbb->count;
+  }
+  return FALSE;
+}
+
+///////////////////////////////////////////////////////////////////
+// Remove the oldest entry, which the caller writes into the L2
+///////////////////////////////////////////////////////////////////
+
+Addr    wbb_pop(WBB *wbb){
+  assert(wbb->count);
+  wbb_account(wbb);
+
+  Addr lineaddr = wbb->lineaddr[wbb->head];
+  wbb->head = (wbb->head + 1) % wbb->num_entries;
+  wbb->count--;
+
+  wbb->stat_drain++;
+  return lineaddr;
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+void    wbb_print_stats(WBB *wbb, char *header){
+  double occupancy_avg = 0;
+
+  wbb_account(wbb);
+  if(cycle){
+    occupancy_avg = (double)(wbb->stat_occupancy_sum)/(double)(cycle);
+  }
+
+  printf("\n%s_INSERTS        \t\t : %10llu", header, wbb->stat_insert);
+  printf("\n%s_MERGES         \t\t : %10llu", header, wbb->stat_merge);
+  printf("\n%s_FORWARDS       \t\t : %10llu", header, wbb->stat_forward);
+  printf("\n%s_DRAINS         \t\t : %10llu", header, wbb->stat_drain);
+  printf("\n%s_FULL_STALLS    \t\t : %10llu", header, wbb->stat_full);
+  printf("\n%s_STALL_CYCLES   \t\t : %10llu", header, wbb->stat_stall_cycles);
+  printf("\n%s_AVG_OCCUPANCY  \t\t : %10.3f", header, occupancy_avg);
+  printf("\n%s_MAX_OCCUPANCY  \t\t : %10u", header, wbb->stat_max_occupancy);
+  printf("\n");
+}
@@ -0,0 +1,54 @@
+#ifndef WBB_H
+#define WBB_H
+
+#include "types.h"
+
+#define MAX_WBB_ENTRIES 64
+
+typedef struct WBB WBB;
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+// Writeback buffer between a DCACHE and the L2. Dirty DCACHE victims
+// wait here in FIFO order and are written into the L2 when it is free
+// (see memsys_wbb_drain); a victim whose line is already buffered is
+// combined with that entry. The requester only waits when the buffer
+// is full.
+
+struct WBB {
+  uns    num_entries;
+  Addr   lineaddr[MAX_WBB_ENTRIES]; // circular FIFO, oldest at head
+  uns    head;
+  uns    count;
+
+  uns64  drain_cycle;       // when the L2 can take the oldest entry
+  uns64  stall_cycles;      // full-buffer wait of the current access
+  uns64  last_update_cycle; // for the occupancy integral
+
+  // stats
+  uns64  stat_insert;
+  uns64  stat_merge;
+  uns64  stat_forward;
+  uns64  stat_drain;
+  uns64  stat_full;
+  uns64  stat_stall_cycles;
+  uns64  stat_occupancy_sum; // sum over cycles of entries held
+  uns    stat_max_occupancy;
+};
+
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+WBB    *wbb_new(uns num_entries);
+Flag    wbb_lookup(WBB *wbb, Addr lineaddr);
+Flag    wbb_insert(WBB *wbb, Addr lineaddr, uns64 ready_cycle);
+Flag    wbb_full(WBB *wbb);
+Addr    wbb_pop(WBB *wbb);
+void    wbb_print_stats(WBB *wbb, char *header);
+
+
+
+#endif // WBB_H